@@ -1,84 +1,351 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "../octochip-8/chip8_disasm.h"
+#include "../octochip-8/mapped_file.h"
+#include "../octochip-8/thread_pool.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
 
-int main(int argc, char** argv) {
-	printf("Chip-8 Disassembler\n");
+//Every ROM is mapped, analyzed and listed on a pool worker into that worker's own buffer,
+//then the listings are written out in the order the ROMs were given, so output doesn't depend on the thread count.
+//ROMs go through the pool CHUNK at a time to bound the memory the buffers take.
+
+//Where one ROM's listing ended up
+struct listing {
+	unsigned worker; //Worker whose buffer holds it
+	size_t offset; //Start in that buffer
+	size_t length; //Bytes of listing
+	bool opened; //False if the ROM couldn't be mapped
+};
+
+const unsigned long MAX_ROM = 4096 - 0x200; //Bytes of a ROM that fit in memory
+const size_t CHUNK = 256; //ROMs listed between writes
+
+//Add a file, or every file under a directory in name order
+void addPath(const std::string& path, std::vector<std::string>& files) {
+	std::vector<std::string> entries;
+#if defined(_WIN32)
+	DWORD attributes = GetFileAttributesA(path.c_str());
+	if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+		files.push_back(path);
+		return;
+	}
+	WIN32_FIND_DATAA found;
+	HANDLE find = FindFirstFileA((path + "\\*").c_str(), &found);
+	if (find != INVALID_HANDLE_VALUE) {
+		do {
+			if (strcmp(found.cFileName, ".") != 0 && strcmp(found.cFileName, "..") != 0) {
+				entries.push_back(path + "\\" + found.cFileName);
+			}
+		} while (FindNextFileA(find, &found));
+		FindClose(find);
+	}
+#else
+	struct stat info;
+	DIR* dir = stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode) ? opendir(path.c_str()) : NULL;
+	if (dir == NULL) {
+		files.push_back(path);
+		return;
+	}
+	for (struct dirent* entry = readdir(dir); entry != NULL; entry = readdir(dir)) {
+		if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+			entries.push_back(path + "/" + entry->d_name);
+		}
+	}
+	closedir(dir);
+#endif
+	std::sort(entries.begin(), entries.end());
+	for (size_t i = 0; i < entries.size(); ++i) {
+		addPath(entries[i], files);
+	}
+}
+
+//Append value as that many upper case hex digits
+void appendHex(std::string& out, unsigned value, int digits) {
+	char text[8];
+	for (int i = digits - 1; i >= 0; --i) {
+		text[i] = "0123456789ABCDEF"[value & 0xF];
+		value >>= 4;
+	}
+	out.append(text, digits);
+}
+
+//Append a string as a JSON string
+void appendJsonString(std::string& out, const char* text) {
+	out += '"';
+	for (; *text != '\0'; ++text) {
+		unsigned char c = *text;
+		if (c == '"' || c == '\\') {
+			out += '\\';
+			out += c;
+		} else if (c < 0x20) {
+			out += "\\u00";
+			appendHex(out, c, 2);
+		} else {
+			out += c;
+		}
+	}
+	out += '"';
+}
 
-	//Declare vars
-	FILE* rom_file;
-	unsigned short opcode;
-	unsigned char memory[4096] = { 0 };
-	unsigned short pc = 0x200; //Should this be 0x0 or 0x200?
+//List a ROM as text: code as opcodes, everything else as bytes, sprites drawn as bit rows
+void writeText(std::string& out, const unsigned char memory[4096], unsigned long rom_size, const chip8_disasm& disasm) {
+	char text[128];
+	char line[64];
+	snprintf(line, sizeof(line), "Size: %lu bytes, %u blocks, %u calls\n", rom_size, (unsigned)disasm.getBlocks().size(), (unsigned)disasm.getCalls().size());
+	out += line;
 
-	//Load file
-	if (argv[1] == NULL) {
-		printf("Please enter the file path of the Chip-8 ROM as an argument.");
+	unsigned short pc = 0x200;
+	while (pc < 0x200 + rom_size) {
+		if (disasm.isOpcode(pc)) {
+			if (disasm.isSubroutine(pc)) {
+				out += "\n\nSubroutine 0x";
+				appendHex(out, pc, 3);
+				out += ':';
+			} else if (disasm.blockAt(pc) >= 0) {
+				out += '\n'; //Blank line between blocks
+			}
+			unsigned short opcode = (memory[pc] << 8) | memory[pc + 1];
+			formatOpcode(text, sizeof(text), decodeOpcode(opcode));
+			out += "\n0x";
+			appendHex(out, pc, 3);
+			out += "    ";
+			appendHex(out, opcode, 4);
+			out += "    ";
+			out += text;
+			pc += 2;
+		} else {
+			out += "\n0x";
+			appendHex(out, pc, 3);
+			out += "    ";
+			appendHex(out, memory[pc], 2);
+			out += "      ";
+			if (disasm.kind(pc) == BYTE_SPRITE) {
+				for (int bit = 7; bit >= 0; --bit) {
+					out += (memory[pc] >> bit) & 1 ? '#' : '.';
+				}
+			} else {
+				out += "Data";
+			}
+			pc += 1;
+		}
+	}
+	out += "\n\n";
+}
+
+//List a ROM as one JSON object's fields: blocks, calls, and a listing with runs of data or sprite bytes grouped together
+void writeJson(std::string& out, const unsigned char memory[4096], unsigned long rom_size, const chip8_disasm& disasm) {
+	static const char* KINDS[4] = { "unknown", "code", "data", "sprite" };
+	char text[128];
+	char number[32];
+	snprintf(number, sizeof(number), ", \"size\": %lu", rom_size);
+	out += number;
+
+	out += ", \"blocks\": [";
+	const std::vector<chip8_block>& blocks = disasm.getBlocks();
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		out += i > 0 ? ", {\"start\": \"" : "{\"start\": \"";
+		appendHex(out, blocks[i].start, 3);
+		out += "\", \"end\": \"";
+		appendHex(out, blocks[i].end, 3);
+		out += "\", \"successors\": [";
+		for (int s = 0; s < blocks[i].successor_count; ++s) {
+			out += s > 0 ? ", \"" : "\"";
+			appendHex(out, blocks[i].successors[s], 3);
+			out += '"';
+		}
+		out += ']';
+		if (blocks[i].flow & FLOW_CALL) {
+			out += ", \"callee\": \"";
+			appendHex(out, blocks[i].callee, 3);
+			out += '"';
+		}
+		if (blocks[i].flow & FLOW_INDIRECT) {
+			out += ", \"indirect\": true";
+		}
+		out += '}';
+	}
+
+	out += "], \"calls\": [";
+	const std::vector<chip8_call>& calls = disasm.getCalls();
+	for (size_t i = 0; i < calls.size(); ++i) {
+		out += i > 0 ? ", [\"" : "[\"";
+		appendHex(out, calls[i].site, 3);
+		out += "\", \"";
+		appendHex(out, calls[i].target, 3);
+		out += "\"]";
+	}
+
+	out += "], \"listing\": [";
+	unsigned short pc = 0x200;
+	while (pc < 0x200 + rom_size) {
+		out += pc > 0x200 ? ",\n{\"address\": \"" : "\n{\"address\": \"";
+		appendHex(out, pc, 3);
+		if (disasm.isOpcode(pc)) {
+			unsigned short opcode = (memory[pc] << 8) | memory[pc + 1];
+			formatOpcode(text, sizeof(text), decodeOpcode(opcode));
+			out += "\", \"kind\": \"code\", \"bytes\": \"";
+			appendHex(out, opcode, 4);
+			out += "\", \"text\": ";
+			appendJsonString(out, text);
+			if (disasm.isSubroutine(pc)) {
+				out += ", \"label\": \"subroutine\"";
+			} else if (disasm.blockAt(pc) >= 0) {
+				out += ", \"label\": \"block\"";
+			}
+			pc += 2;
+		} else {
+			unsigned char kind = disasm.kind(pc);
+			out += "\", \"kind\": \"";
+			out += KINDS[kind];
+			out += "\", \"bytes\": \"";
+			do {
+				appendHex(out, memory[pc], 2);
+				++pc;
+			} while (pc < 0x200 + rom_size && !disasm.isOpcode(pc) && disasm.kind(pc) == kind);
+			out += '"';
+		}
+		out += '}';
+	}
+	out += "]";
+}
+
+//Main
+int main(int argc, char** argv) {
+	//Check if enough arguments are supplied
+	std::vector<std::string> files;
+	const char* output_path = NULL;
+	bool json = false;
+	unsigned threads = 0;
+	for (int i = 1; i < argc; ++i) {
+		if (strcmp(argv[i], "--json") == 0) {
+			json = true;
+		} else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+			output_path = argv[++i];
+		} else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			if (!thread_pool::parseThreads(argv[++i], threads)) {
+				printf("Bad thread count %s, use 0 for one per core\n", argv[i]);
+				return(1);
+			}
+		} else if (strncmp(argv[i], "--", 2) == 0) {
+			printf("%s: %s\n", i + 1 < argc ? "Unknown option" : "Unknown option or missing value", argv[i]);
+			return(1);
+		} else {
+			addPath(argv[i], files);
+		}
+	}
+	if (files.empty()) {
+		printf("Chip-8 Disassembler\n");
+		printf("Please enter the file paths of Chip-8 ROMs or directories of them as arguments.\n");
+		printf("Usage: chip-8-disassembler <ROM or directory ...> [--json] [--output file] [--threads N]\n");
 		return(1);
 	}
-	printf("File: %s\n", argv[1]);
-	#pragma warning(suppress : 4996)
-	rom_file = fopen(argv[1], "rb");
-	fread(&memory, 1, 4096, rom_file);
-	fclose(rom_file);
-
-	//Disassemble
-	for (pc; pc < 4095; pc += 2) {
-		opcode = (memory[pc] << 8) | memory[pc + 1];
-
-		printf("\n0x%03X    %04X    ", pc, opcode);
-
-		switch (opcode & 0xF000) {
-		case 0x0000:
-			switch (opcode & 0x00FF) {
-			case 0x00E0: printf("Clears the screen"); break;
-			case 0x00EE: printf("Returns from a subroutine"); break;
-			} break;
-		case 0x1000: printf("Jumps to address 0x%03X", opcode & 0x0FFF); break;
-		case 0x2000: printf("Calls subroutine at 0x%03X", opcode & 0x0FFF); break;
-		case 0x3000: printf("Skips next instruction if V%X == %02X", (opcode & 0x0F00) >> 8, opcode & 0x00FF); break;
-		case 0x4000: printf("Skips next instruction if V%X != %02X", (opcode & 0x0F00) >> 8, opcode & 0x00FF); break;
-		case 0x5000: printf("Skips next instruction if V%X == V%X", (opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); break;
-		case 0x6000: printf("V%X = %02X", (opcode & 0x0F00) >> 8, opcode & 0x00FF); break;
-		case 0x7000: printf("V%X += %02X (Carry flag not changed)", (opcode & 0x0F00) >> 8, opcode & 0x00FF); break;
-		case 0x8000: 
-			switch (opcode & 0x000F) {
-			case 0x0000: printf("V%X = V%X", (opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); break;
-			case 0x0001: printf("V%X = V%X | V%X (or)", (opcode & 0x0F00) >> 8, (opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); break;
-			case 0x0002: printf("V%X = V%X & V%X (and)", (opcode & 0x0F00) >> 8, (opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); break;
-			case 0x0003: printf("V%X = V%X ^ V%X (xor)", (opcode & 0x0F00) >> 8, (opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); break;
-			case 0x0004: printf("V%X += V%X (VF = 1 if there is a carry)", (opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); break;
-			case 0x0005: printf("V%X -= V%X (VF = 1 if there is a borrow)", (opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); break;
-			case 0x0006: printf("Stores LSB of V%X in VF, shifts V%X to the right by 1 (Diff implementations)", (opcode & 0x0F00) >> 8, (opcode & 0x0F00) >> 8); break;
-			case 0x0007: printf("V%X = V%X - V%X (VF = 1 if there is a borrow)", (opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4, (opcode & 0x0F00) >> 8); break;
-			case 0x000E: printf("Stores MSB of V%X in VF, shifts V%X to the left by 1 (Diff implementations)", (opcode & 0x0F00) >> 8, (opcode & 0x0F00) >> 8); break;
-			} break;
-		case 0x9000: printf("Skips next instruction if V%X != V%X", (opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4); break;
-		case 0xA000: printf("I = %03X (Memory location)", opcode & 0x0FFF); break;
-		case 0xB000: printf("Jumps to address 0x%03X + V0", opcode & 0x0FFF); break;
-		case 0xC000: printf("V%X = (Random number) & %03X ", (opcode & 0x0F00) >> 8, opcode & 0x00FF); break;
-		case 0xD000: printf("Draw sprite at (V%X, V%X) with a width/height of 8/(%X+1) pixels", (opcode & 0x0F00) >> 8, (opcode & 0x00F0) >> 4, opcode & 0x000F); break;
-		case 0xE000:
-			switch (opcode & 0x00FF) {
-			case 0x009E: printf("Skips next instruction if key stored in V%X is pressed", (opcode & 0x0F00) >> 8); break;
-			case 0x00A1: printf("Skips next instruction if key stored in V%X is not pressed", (opcode & 0x0F00) >> 8); break;
-			} break;
-		case 0xF000:
-			switch (opcode & 0x00FF) {
-			case 0x0007: printf("Sets V%X to the value of the delay timer", (opcode & 0x0F00) >> 8); break;
-			case 0x000A: printf("Halts instruction until a keypress, and stores the key in V%X", (opcode & 0x0F00) >> 8); break;
-			case 0x0015: printf("Sets the delay timer to V%X", (opcode & 0x0F00) >> 8); break;
-			case 0x0018: printf("Sets the sound timer to V%X", (opcode & 0x0F00) >> 8); break;
-			case 0x001E: printf("I += V%X (Does not affect VF)", (opcode & 0x0F00) >> 8); break;
-			case 0x0029: printf("Sets I to the location the sprite for the character in V%X", (opcode & 0x0F00) >> 8); break;
-			case 0x0033: printf("Stores the binary-coded decimal representation of V%X at I", (opcode & 0x0F00) >> 8); break;
-			case 0x0055: printf("Stores the values from V0 to V%X starting at the memory address stored in I", (opcode & 0x0F00) >> 8); break;
-			case 0x0065: printf("Fills the values from V0 to V%X starting at the memory address stored in I", (opcode & 0x0F00) >> 8); break;
-			} break;
-
-		//default: printf("Unknown opcode"); break;
+	FILE* output = stdout;
+	if (output_path != NULL) {
+		#pragma warning(suppress : 4996)
+		output = fopen(output_path, "wb");
+		if (output == NULL) {
+			printf("Could not open %s\n", output_path);
+			return(1);
 		}
 	}
+	FILE* log = output == stdout ? stderr : stdout; //Progress goes wherever the listing doesn't
 
+	//Disassemble every ROM, each worker reusing its own memory, analysis and output buffer
+	thread_pool pool(threads);
+	std::vector<std::string> buffers(pool.size());
+	std::vector<chip8_disasm> analyses(pool.size());
+	std::vector<unsigned char> memories(pool.size() * 4096);
+	std::vector<listing> listings(std::min(CHUNK, files.size()));
+	long long start = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	size_t failed = 0;
+	if (json) {
+		fputs("{\"roms\": [\n", output);
+	} else if (output == stdout) {
+		fputs("Chip-8 Disassembler\n", output);
+	}
+
+	//ROMs are run in chunks so a whole archive's listing is never held in memory at once
+	for (size_t first = 0; first < files.size(); first += CHUNK) {
+		size_t count = std::min(CHUNK, files.size() - first);
+		for (unsigned w = 0; w < pool.size(); ++w) {
+			buffers[w].clear();
+		}
+		pool.run(count, [&](size_t job, unsigned worker) {
+			size_t index = first + job;
+			std::string& out = buffers[worker];
+			listing& l = listings[job];
+			l.worker = worker;
+			l.offset = out.size();
+
+			mapped_file rom;
+			l.opened = rom.open(files[index].c_str());
+			if (json) {
+				out += "{\"rom\": ";
+				appendJsonString(out, files[index].c_str());
+			} else {
+				out += "File: ";
+				out += files[index];
+				out += '\n';
+			}
+			if (!l.opened) {
+				out += json ? ", \"error\": \"open\"}" : "Could not open file\n\n";
+				l.length = out.size() - l.offset;
+				return;
+			}
+
+			//Only the ROM's own bytes are listed, anything past the end of memory is cut off
+			unsigned char* memory = &memories[worker * 4096];
+			unsigned long rom_size = std::min(rom.size(), MAX_ROM);
+			memset(memory, 0, 4096);
+			if (rom_size > 0) {
+				memcpy(memory + 0x200, rom.data(), rom_size);
+			}
+			analyses[worker].analyze(memory, rom_size);
+			if (json) {
+				writeJson(out, memory, rom_size, analyses[worker]);
+				if (rom.size() > MAX_ROM) {
+					out += ", \"truncated\": true";
+				}
+				out += '}';
+			} else {
+				if (rom.size() > MAX_ROM) {
+					out += "Truncated to the 3584 bytes that fit in memory\n";
+				}
+				writeText(out, memory, rom_size, analyses[worker]);
+			}
+			l.length = out.size() - l.offset;
+		});
+
+		//Write the chunk's listings in the order given
+		for (size_t job = 0; job < count; ++job) {
+			const listing& l = listings[job];
+			fwrite(buffers[l.worker].data() + l.offset, 1, l.length, output);
+			if (json) {
+				fputs(first + job + 1 < files.size() ? ",\n" : "\n", output);
+			}
+			failed += l.opened ? 0 : 1;
+		}
+	}
+	if (json) {
+		fputs("]}\n", output);
+	}
+	bool written = output == stdout ? fflush(output) == 0 : fclose(output) == 0;
+	if (!written) {
+		fprintf(log, "Could not write %s\n", output_path != NULL ? output_path : "output");
+		return(1);
+	}
 
-	return 0;
-}
\ No newline at end of file
+	long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() - start;
+	fprintf(log, "Disassembled %u ROMs on %u threads in %lli ms, %u could not be opened.\n", (unsigned)files.size(), pool.size(), elapsed, (unsigned)failed);
+	return failed > 0 ? 1 : 0;
+}
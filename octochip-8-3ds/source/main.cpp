@@ -11,7 +11,7 @@
 //Declare 3ds variables
 PrintConsole botScr;
 C3D_RenderTarget* topScr;
-const int MODIFIER = 6;
+const int DISPLAY_SIZE = 384; //Width of the chip8 display on the top screen, the same at either resolution
 
 //Declare color variables
 u32 BLACK = C2D_Color32(0, 0, 0, 255);
@@ -45,7 +45,7 @@ int main(int argc, char* argv[]) {
 	gfxInitDefault();
 	hidInit();
 	C3D_Init(C3D_DEFAULT_CMDBUF_SIZE);
-	C2D_Init(C2D_DEFAULT_MAX_OBJECTS);
+	C2D_Init(chip8::MAX_WIDTH * chip8::MAX_HEIGHT + 1); //Every pixel of the high resolution display lit, and the background
 	C2D_Prepare();
 	consoleInit(GFX_BOTTOM, &botScr);
 	topScr = C2D_CreateScreenTarget(GFX_TOP, GFX_LEFT);
@@ -69,6 +69,7 @@ int main(int argc, char* argv[]) {
 	int mode = 1; //Regular vs Cycle by cycle, see Modes comment below
 	u64 count_ticks = svcGetSystemTick(); //Used for counting how many cycles actually execute per second
 	int cycles = 0; //Used for counting how many cycles actually execute per second
+	int cycle_debt = 0; //Cycles run since the timers last ticked, in 1/60 of a cycle
 	bool display_registers = true; //Whether the registers should be displayed
 	int max_cycles = 500; //Maximum cycles per second
 	double cycle_length = 1000.0 / max_cycles; //Ticks per cycle
@@ -199,26 +200,36 @@ int main(int argc, char* argv[]) {
 			if (!myChip8.emulateCycle()) {
 				mode = 3;
 			}
+			cycle_debt += 60;
+			if (cycle_debt >= max_cycles) { //The timers tick once a frame's worth of cycles has run
+				cycle_debt -= max_cycles;
+				myChip8.updateTimers();
+			}
 
 			//Update chip8 display if it has changed
-			if (myChip8.draw_flag) {
+			if (myChip8.dirty_rows != 0) {
 				C3D_FrameBegin(C3D_FRAME_SYNCDRAW);
 				C2D_TargetClear(topScr, GRAY);
 				C2D_SceneBegin(topScr);
 
-				C2D_DrawRectSolid(8, 24, 0, 64 * MODIFIER, 32 * MODIFIER, BLACK);
+				C2D_DrawRectSolid(8, 24, 0, DISPLAY_SIZE, DISPLAY_SIZE / 2, BLACK);
 
-				for (int y = 0; y < 32; ++y) {
-					for (int x = 0; x < 64; ++x) {
-						if (myChip8.gfx[x + (y * 64)] == 1) {
-							C2D_DrawRectSolid((x * MODIFIER) + 8, (y * MODIFIER) + 24, 0, MODIFIER, MODIFIER, WHITE);
+				//Pixels are 6 screen pixels in the low resolution and 3 in the high one
+				static unsigned char pixels[chip8::MAX_WIDTH * chip8::MAX_HEIGHT];
+				int width = myChip8.getWidth();
+				int modifier = DISPLAY_SIZE / width;
+				myChip8.getPixels(pixels);
+				for (int y = 0; y < myChip8.getHeight(); ++y) {
+					for (int x = 0; x < width; ++x) {
+						if (pixels[x + (y * width)] == 1) {
+							C2D_DrawRectSolid((x * modifier) + 8, (y * modifier) + 24, 0, modifier, modifier, WHITE);
 						}
 					}
 				}
 
 				C3D_FrameEnd(0);
-				//Set draw flag to false
-				myChip8.draw_flag = false;
+				//The whole screen is drawn again every frame, so every row is clean
+				myChip8.dirty_rows = 0;
 			}
 
 			if (display_registers) {
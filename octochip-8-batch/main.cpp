@@ -0,0 +1,356 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include "../octochip-8/audio.h"
+#include "../octochip-8/chip8.h"
+#include "../octochip-8/input_record.h"
+#include "../octochip-8/mapped_file.h"
+#include "../octochip-8/rom_pack.h"
+#include "../octochip-8/thread_pool.h"
+
+//Manifest lines look like "<ROM path> <cycle budget> [input script]", # starts a comment.
+//Input scripts are input_record files: one "<cycle> <key in hex> <1 down | 0 up>" per line,
+//plus optional "seed <hex>", "speed <cycles/s>" and "quirks <profile name>" lines that override --seed, --speed and --quirks for that job.
+//With --pack, ROMs are loaded from a rom_pack by their manifest path instead of from disk, falling back to disk for any the pack lacks.
+//With --wav, each job's buzzer is written to <directory>/<job index>.wav, counting jobs from 0 in manifest order.
+
+//One manifest line and its result
+struct job {
+	std::string rom; //ROM path
+	unsigned long long budget; //Emulated cycles to run for
+	std::string script; //Input script path, empty for none
+	uint32_t seed; //CXNN seed the job ran with
+	int speed; //Cycles per second the job ran at
+	chip8::quirk_profile quirks; //Quirk profile the job ran with
+	const char* exit; //Why the job stopped
+	unsigned long long cycles; //Emulated cycles, including ones spent idle waiting for a key
+	unsigned long long frames; //Frames run
+	uint64_t frame_hash; //Hash of the final display
+	unsigned short registers[40]; //Final registers from getRegisters
+};
+
+//What the watchdog knows about one worker
+struct worker_state {
+	std::atomic<size_t> current; //Job being run plus one, 0 when idle
+	std::atomic<long long> started; //Milliseconds the current job started at
+	std::atomic<size_t> cancelled; //Job the watchdog killed plus one
+};
+
+int speed = 500; //Cycles per second, so a frame is speed / 60 cycles like the SDL frontend
+uint32_t seed = 1; //CXNN seed for jobs whose script doesn't set one
+chip8::quirk_profile quirks = chip8::QUIRKS_OCTOCHIP; //Quirk profile for jobs whose script doesn't set one
+long long timeout = 10000; //Wall clock milliseconds a job may run, 0 for no limit
+const int LOOP_CHECK_FRAMES = 60; //Frames between state checks for an infinite loop
+rom_pack pack; //ROMs to load from instead of disk, empty without --pack
+std::string wavDirectory; //Directory each job's audio is written to, empty without --wav
+const int AUDIO_RATE = 44100; //Samples per second in the WAV files
+const int AUDIO_FRAME = AUDIO_RATE / 60; //Samples per frame
+const int TONE_FREQUENCY = 440; //Pitch of the buzzer in Hz
+const int16_t TONE_AMPLITUDE = 3000;
+
+//Milliseconds since an arbitrary point
+long long nowMs() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Read a manifest, false if it can't be opened
+bool loadManifest(const char* path, std::vector<job>& jobs) {
+	#pragma warning(suppress : 4996)
+	FILE* file = fopen(path, "r");
+	if (file == NULL) {
+		return false;
+	}
+	char line[1024];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		char rom[512] = { 0 };
+		char script[512] = { 0 };
+		unsigned long long budget = 0;
+		if (line[0] == '#') {
+			continue;
+		}
+		#pragma warning(suppress : 4996)
+		if (sscanf(line, "%511s %llu %511s", rom, &budget, script) < 2) {
+			continue;
+		}
+		job j;
+		j.rom = rom;
+		j.budget = budget;
+		j.script = script;
+		j.seed = seed;
+		j.speed = speed;
+		j.quirks = quirks;
+		j.exit = "not run";
+		j.cycles = j.frames = 0;
+		j.frame_hash = 0;
+		memset(j.registers, 0, sizeof(j.registers));
+		jobs.push_back(j);
+	}
+	fclose(file);
+	return true;
+}
+
+//Run one job on a worker's machine
+void runJob(job& j, size_t index, chip8& machine, worker_state& state) {
+	input_record input;
+	input.clear(seed, speed);
+	input.quirks = chip8::quirksName(quirks);
+	if (!j.script.empty() && !input.load(j.script.c_str())) {
+		j.exit = "script";
+		return;
+	}
+	if (!chip8::findQuirks(input.quirks.c_str(), j.quirks)) {
+		j.exit = "quirks";
+		return;
+	}
+	machine.setQuirks(j.quirks);
+	j.seed = input.seed;
+	j.speed = std::max(1, input.speed);
+	machine.seed(j.seed);
+	long packed = pack.find(j.rom.c_str());
+	mapped_file rom; //Loaded from memory either way, so a whole manifest doesn't print a line per job
+	bool loaded = packed >= 0 ? machine.loadFromBuffer(pack.data(packed), pack.size(packed))
+		: rom.open(j.rom.c_str()) && machine.loadFromBuffer(rom.data(), rom.size());
+	if (!loaded) {
+		j.exit = "load";
+		return;
+	}
+
+	//Audio is rendered a frame at a time from the frame's sound events
+	wav_writer wav;
+	square_wave wave(AUDIO_RATE, TONE_FREQUENCY, TONE_AMPLITUDE);
+	int16_t samples[AUDIO_FRAME];
+	if (!wavDirectory.empty() && !wav.open((wavDirectory + "/" + std::to_string(index) + ".wav").c_str(), AUDIO_RATE)) {
+		j.exit = "wav";
+		return;
+	}
+	machine.sound_event_count = 0;
+
+	int cycle_debt = 0; //Cycles carried between frames, in 1/60ths of a cycle
+	uint64_t last_state = machine.getStateHash();
+	j.exit = "budget";
+	while (j.cycles < j.budget) {
+		if (state.cancelled.load(std::memory_order_relaxed) == index + 1) {
+			j.exit = "timeout";
+			break;
+		}
+
+		//Apply input due by the start of this frame
+		unsigned short keys = input.replay(j.cycles);
+		for (int i = 0; i < 16; ++i) {
+			machine.key[i] = (keys >> i) & 1;
+		}
+
+		//The frame's cycles pass even if the machine stops early to wait for a key
+		cycle_debt += j.speed;
+		unsigned long long frame = std::min<unsigned long long>(cycle_debt / 60, j.budget - j.cycles);
+		cycle_debt %= 60;
+		uint64_t start = machine.cycles_total;
+		chip8::run_result result = machine.runFrame((unsigned long)frame);
+		j.cycles += frame;
+		++j.frames;
+		if (!wavDirectory.empty()) {
+			wave.render(samples, AUDIO_FRAME, machine.sound_events, machine.sound_event_count, start, machine.cycles_total - start);
+			machine.sound_event_count = 0;
+			wav.write(samples, AUDIO_FRAME);
+		}
+
+		if (result == chip8::RUN_INVALID_OPCODE) {
+			j.exit = "invalid";
+			break;
+		}
+		if (result == chip8::RUN_WAIT_KEY && input.finished()) {
+			j.exit = "wait_key";
+			break;
+		}
+
+		//With no input left to come, a state that repeats can never change again
+		if (j.frames % LOOP_CHECK_FRAMES == 0) {
+			uint64_t hash = machine.getStateHash();
+			if (hash == last_state && input.finished()) {
+				j.exit = "loop";
+				break;
+			}
+			last_state = hash;
+		}
+	}
+
+	j.frame_hash = machine.getFrameHash();
+	machine.getRegisters(j.registers);
+	if (!wavDirectory.empty() && !wav.close()) {
+		j.exit = "wav";
+	}
+}
+
+//Write a string as a JSON string
+void writeJsonString(FILE* file, const std::string& text) {
+	fputc('"', file);
+	for (size_t i = 0; i < text.size(); ++i) {
+		unsigned char c = text[i];
+		if (c == '"' || c == '\\') {
+			fprintf(file, "\\%c", c);
+		} else if (c < 0x20) {
+			fprintf(file, "\\u%04x", c);
+		} else {
+			fputc(c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+//Write every result as one JSON document, false if it can't be written in full
+bool writeReport(const char* path, const std::vector<job>& jobs) {
+	#pragma warning(suppress : 4996)
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		return false;
+	}
+	const char* names[40] = {
+		"V0", "V1", "V2", "V3", "V4", "V5", "V6", "V7", "V8", "V9", "VA", "VB", "VC", "VD", "VE", "VF",
+		"S0", "S1", "S2", "S3", "S4", "S5", "S6", "S7", "S8", "S9", "SA", "SB", "SC", "SD", "SE", "SF",
+		"OP", "PC", "I", "SP", NULL, NULL, "DT", "ST"
+	};
+	fprintf(file, "{\n\"speed\": %i,\n\"jobs\": [\n", speed);
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		const job& j = jobs[i];
+		fprintf(file, "{\"rom\": ");
+		writeJsonString(file, j.rom);
+		fprintf(file, ", \"seed\": \"%08x\", \"speed\": %i, \"quirks\": \"%s\", \"exit\": \"%s\", \"cycles\": %llu, \"frames\": %llu, \"frame_hash\": \"%016llx\", \"registers\": {",
+			(unsigned int)j.seed, j.speed, chip8::quirksName(j.quirks), j.exit, j.cycles, j.frames, (unsigned long long)j.frame_hash);
+		bool first = true;
+		for (int r = 0; r < 40; ++r) {
+			if (names[r] != NULL) {
+				fprintf(file, "%s\"%s\": %u", first ? "" : ", ", names[r], j.registers[r]);
+				first = false;
+			}
+		}
+		fprintf(file, "}}%s\n", i + 1 < jobs.size() ? "," : "");
+	}
+	fprintf(file, "]\n}\n");
+	bool written = ferror(file) == 0;
+	return fclose(file) == 0 && written;
+}
+
+//Main
+int main(int argc, char** argv) {
+	printf("OctoChip-8 Batch Runner\n\n");
+
+	//Check if enough arguments are supplied
+	if (argc < 3) {
+		printf("Usage: octochip-8-batch <manifest> <report.json> [--threads N] [--speed cycles/s] [--timeout ms] [--seed hex] [--quirks profile] [--pack file] [--jit] [--wav directory]\n");
+		printf("       octochip-8-batch --make-pack <pack> <manifest>\n");
+		return 1;
+	}
+
+	//Pack every ROM a manifest names, under the path the manifest gives
+	if (strcmp(argv[1], "--make-pack") == 0) {
+		std::vector<job> jobs;
+		if (argc < 4 || !loadManifest(argv[3], jobs)) {
+			printf("Could not open manifest %s\n", argc < 4 ? "" : argv[3]);
+			return 1;
+		}
+		std::vector<std::string> roms;
+		for (size_t i = 0; i < jobs.size(); ++i) {
+			roms.push_back(jobs[i].rom);
+		}
+		std::sort(roms.begin(), roms.end());
+		roms.erase(std::unique(roms.begin(), roms.end()), roms.end());
+		if (!rom_pack::write(argv[2], roms, roms)) {
+			printf("Could not write pack %s\n", argv[2]);
+			return 1;
+		}
+		printf("Packed %u ROMs into %s.\n", (unsigned)roms.size(), argv[2]);
+		return 0;
+	}
+
+	unsigned threads = 0;
+	bool use_jit = false;
+	for (int i = 3; i < argc; ++i) {
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			if (!thread_pool::parseThreads(argv[++i], threads)) {
+				printf("Bad thread count %s, use 0 for one per core\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+			speed = std::max(1, atoi(argv[++i]));
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = (uint32_t)strtoul(argv[++i], NULL, 16);
+		} else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+			if (!chip8::findQuirks(argv[++i], quirks)) {
+				printf("Unknown quirk profile %s, use octochip, vip, schip or xochip\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+			timeout = atoll(argv[++i]);
+		} else if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc) {
+			if (!pack.open(argv[++i])) {
+				printf("Could not open pack %s\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--wav") == 0 && i + 1 < argc) {
+			wavDirectory = argv[++i];
+		} else if (strcmp(argv[i], "--jit") == 0) {
+			use_jit = true;
+		} else {
+			printf("%s: %s\n", i + 1 < argc ? "Unknown option" : "Unknown option or missing value", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<job> jobs;
+	if (!loadManifest(argv[1], jobs)) {
+		printf("Could not open manifest %s\n", argv[1]);
+		return 1;
+	}
+
+	thread_pool pool(threads);
+	std::vector<chip8> machines(pool.size()); //One machine per worker, reused for every job it runs
+	std::vector<worker_state> states(pool.size());
+	for (unsigned w = 0; w < pool.size(); ++w) {
+		states[w].current = 0;
+		states[w].started = 0;
+		states[w].cancelled = 0;
+		if (use_jit && !machines[w].enableJit(true)) {
+			printf("JIT not available on this host, interpreting.\n");
+			use_jit = false;
+		}
+	}
+
+	//Watchdog, kills any job that runs past the timeout
+	std::atomic<bool> finished(false);
+	std::thread watchdog([&]() {
+		while (!finished.load()) {
+			long long now = nowMs();
+			for (size_t w = 0; w < states.size(); ++w) {
+				size_t current = states[w].current.load();
+				if (timeout > 0 && current != 0 && now - states[w].started.load() > timeout) {
+					states[w].cancelled.store(current);
+				}
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		}
+	});
+
+	long long start = nowMs();
+	pool.run(jobs.size(), [&](size_t index, unsigned worker) {
+		worker_state& state = states[worker];
+		state.started.store(nowMs());
+		state.current.store(index + 1);
+		runJob(jobs[index], index, machines[worker], state);
+		state.current.store(0);
+	});
+	finished.store(true);
+	watchdog.join();
+
+	if (!writeReport(argv[2], jobs)) {
+		printf("Could not write report %s\n", argv[2]);
+		return 1;
+	}
+	printf("\nRan %u jobs on %u threads in %lli ms.\n", (unsigned)jobs.size(), pool.size(), nowMs() - start);
+	return 0;
+}
@@ -0,0 +1,632 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "../octochip-8/chip8.h"
+#include "../octochip-8/chip8_lanes.h"
+#include "../octochip-8/state_table.h"
+#if defined(BENCH_SDL)
+#include <SDL.h>
+#endif
+
+//Every measurement is taken SAMPLES times after one warm-up, and reported as its median and percentiles
+//so one noisy sample doesn't move the result. Results are printed and written as one JSON document.
+
+//Statistics of one measurement
+struct result {
+	std::string name; //What was measured
+	const char* unit; //Unit of every statistic
+	double median, p10, p90, min, max; //Over the samples
+	int samples; //Samples taken
+};
+
+const int SAMPLES = 21; //Samples per measurement, after the warm-up
+std::vector<result> results;
+
+//Seconds since an arbitrary point
+double now() {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Sort samples and record their median and percentiles
+void report(const std::string& name, const char* unit, std::vector<double> samples) {
+	std::sort(samples.begin(), samples.end());
+	size_t last = samples.size() - 1;
+	result r;
+	r.name = name;
+	r.unit = unit;
+	r.median = samples[last / 2];
+	r.p10 = samples[last / 10];
+	r.p90 = samples[last - last / 10];
+	r.min = samples[0];
+	r.max = samples[last];
+	r.samples = (int)samples.size();
+	results.push_back(r);
+	printf("%-40s %12.2f %-8s (p10 %.2f, p90 %.2f)\n", name.c_str(), r.median, unit, r.p10, r.p90);
+}
+
+//Bytes of a synthetic ROM
+std::vector<uint8_t> romBytes(const std::vector<unsigned short>& opcodes) {
+	std::vector<uint8_t> rom;
+	for (size_t i = 0; i < opcodes.size(); ++i) {
+		rom.push_back((uint8_t)(opcodes[i] >> 8));
+		rom.push_back((uint8_t)(opcodes[i] & 0xFF));
+	}
+	return rom;
+}
+
+//Fill the rest of memory after setup with body, repeated, then jump back to the first copy of body
+std::vector<unsigned short> unrolled(const std::vector<unsigned short>& setup, const std::vector<unsigned short>& body) {
+	std::vector<unsigned short> rom(setup);
+	unsigned short loop = (unsigned short)(0x200 + rom.size() * 2);
+	while ((rom.size() + body.size() + 1) * 2 < 4096 - 0x200 - 2) {
+		rom.insert(rom.end(), body.begin(), body.end());
+	}
+	rom.push_back(0x1000 | loop);
+	return rom;
+}
+
+//Nanoseconds per instruction running cycles at a time, through runCycles or one emulateCycle call per instruction
+void benchInstructions(const std::string& name, const std::vector<uint8_t>& rom, bool stepped, bool jit, unsigned long cycles) {
+	chip8 machine;
+	if (jit && !machine.enableJit(true)) {
+		printf("%-40s JIT not available on this host\n", name.c_str());
+		return;
+	}
+	if (!machine.loadFromBuffer(rom.data(), rom.size())) {
+		return;
+	}
+	std::vector<double> samples;
+	for (int s = 0; s <= SAMPLES; ++s) {
+		unsigned long run = 0;
+		double start = now();
+		if (stepped) {
+			for (; run < cycles && machine.emulateCycle(); ++run) continue;
+		} else {
+			while (run < cycles) {
+				chip8::run_result r = machine.runCycles(cycles - run);
+				run += machine.cycles_run;
+				if (r == chip8::RUN_INVALID_OPCODE || (r == chip8::RUN_WAIT_KEY && machine.cycles_run == 0)) {
+					break;
+				}
+			}
+		}
+		double elapsed = now() - start;
+		if (run == 0) {
+			printf("%-40s stopped before running anything\n", name.c_str());
+			return;
+		}
+		if (s > 0) {
+			samples.push_back(elapsed * 1e9 / run);
+		}
+	}
+	report(name, "ns/instr", samples);
+}
+
+//Nanoseconds per 60hz frame of cyclesPerFrame cycles with the timers ticking after each, from a fresh load every
+//sample, through runFrame or one emulateCycle call per instruction. Idle loops only end when the timers tick, so this
+//is what fast-forwarding them saves.
+void benchFrames(const std::string& name, const std::vector<uint8_t>& rom, bool stepped, bool jit, unsigned long cyclesPerFrame, int frames) {
+	chip8 machine;
+	if (jit && !machine.enableJit(true)) {
+		printf("%-40s JIT not available on this host\n", name.c_str());
+		return;
+	}
+	std::vector<double> samples;
+	for (int s = 0; s <= SAMPLES; ++s) {
+		if (!machine.loadFromBuffer(rom.data(), rom.size())) {
+			return;
+		}
+		double start = now();
+		for (int f = 0; f < frames; ++f) {
+			if (stepped) {
+				for (unsigned long c = 0; c < cyclesPerFrame && machine.emulateCycle(); ++c) continue;
+				machine.updateTimers();
+			} else {
+				machine.runFrame(cyclesPerFrame);
+			}
+		}
+		if (s > 0) {
+			samples.push_back((now() - start) * 1e9 / frames);
+		}
+	}
+	report(name, "ns/frame", samples);
+}
+
+//Run rom interpreted and through the JIT for frames frames, changing the keys every few frames, and compare the whole
+//saved state after each one. Idle loops are fast-forwarded on both sides, so they're covered too. False on the first
+//frame where they differ.
+bool checkJit(const std::string& name, const std::vector<uint8_t>& rom, int frames, unsigned long cyclesPerFrame) {
+	chip8 interpreted, translated;
+	if (!translated.enableJit(true)) {
+		return true;
+	}
+	if (!interpreted.loadFromBuffer(rom.data(), rom.size()) || !translated.loadFromBuffer(rom.data(), rom.size())) {
+		printf("%-40s could not load\n", name.c_str());
+		return false;
+	}
+	static unsigned char expected[chip8::STATE_SIZE], actual[chip8::STATE_SIZE];
+	for (int f = 0; f < frames; ++f) {
+		for (int k = 0; k < 16; ++k) {
+			interpreted.key[k] = translated.key[k] = (unsigned char)((f / 7 + k) % 5 == 0);
+		}
+		chip8::run_result a = interpreted.runFrame(cyclesPerFrame);
+		chip8::run_result b = translated.runFrame(cyclesPerFrame);
+		interpreted.saveState(expected, sizeof(expected));
+		translated.saveState(actual, sizeof(actual));
+		if (a != b || interpreted.cycles_run != translated.cycles_run || memcmp(expected, actual, sizeof(expected)) != 0) {
+			printf("%-40s JIT differs from the interpreter after frame %i\n", name.c_str(), f + 1);
+			return false;
+		}
+		if (a == chip8::RUN_INVALID_OPCODE) {
+			break;
+		}
+	}
+	return true;
+}
+
+//Nanoseconds per instruction running rom on the 32 lanes of chip8_lanes, against 32 chip8s each running the same
+//frames one after another. Every lane gets its own CXNN seed.
+void benchLanes(const std::string& name, const std::vector<uint8_t>& rom, unsigned long cyclesPerFrame, int frames) {
+	chip8_lanes* lanes = new chip8_lanes;
+	std::vector<chip8> machines(chip8_lanes::LANES);
+	std::vector<double> together, apart;
+	for (int s = 0; s <= SAMPLES; ++s) {
+		if (!lanes->loadFromBuffer(rom.data(), rom.size())) {
+			break;
+		}
+		unsigned long run = 0;
+		double start = now();
+		for (int f = 0; f < frames; ++f) {
+			lanes->runFrame(cyclesPerFrame);
+			for (int lane = 0; lane < chip8_lanes::LANES; ++lane) {
+				run += lanes->cycles_run[lane];
+			}
+		}
+		double elapsed = now() - start;
+		if (s > 0 && run > 0) {
+			together.push_back(elapsed * 1e9 / run);
+		}
+
+		for (int lane = 0; lane < chip8_lanes::LANES; ++lane) {
+			machines[lane].seed(lane + 1);
+			machines[lane].loadFromBuffer(rom.data(), rom.size());
+		}
+		run = 0;
+		start = now();
+		for (int lane = 0; lane < chip8_lanes::LANES; ++lane) {
+			for (int f = 0; f < frames; ++f) {
+				machines[lane].runFrame(cyclesPerFrame);
+				run += machines[lane].cycles_run;
+			}
+		}
+		elapsed = now() - start;
+		if (s > 0 && run > 0) {
+			apart.push_back(elapsed * 1e9 / run);
+		}
+	}
+	delete lanes;
+	if (together.empty() || apart.empty()) {
+		printf("%-40s stopped before running anything\n", name.c_str());
+		return;
+	}
+	report(name + " lanes", "ns/instr", together);
+	report(name + " 32 chip8", "ns/instr", apart);
+}
+
+//Run rom on every lane of chip8_lanes and on 32 chip8s with the same quirks, seeds and keys, which differ between
+//lanes and change every few frames, and compare each lane's registers, stack, timers and display after every
+//frame. False on the first lane and frame where they differ. A lane that stops on an SCHIP opcode, which lanes
+//don't model, ends the check without failing it.
+bool checkLanes(const std::string& name, const std::vector<uint8_t>& rom, chip8::quirk_profile quirks, int frames, unsigned long cyclesPerFrame) {
+	const int LANES = chip8_lanes::LANES;
+	chip8_lanes* lanes = new chip8_lanes;
+	std::vector<chip8> machines(LANES);
+	lanes->setQuirks(quirks);
+	bool loaded = lanes->loadFromBuffer(rom.data(), rom.size());
+	for (int lane = 0; lane < LANES && loaded; ++lane) {
+		uint32_t seed = lane * 0x9E3779B9u + 1;
+		lanes->seed(lane, seed);
+		machines[lane].setQuirks(quirks);
+		machines[lane].seed(seed);
+		loaded = machines[lane].loadFromBuffer(rom.data(), rom.size());
+	}
+	std::string check = name + " lanes check " + chip8::quirksName(quirks);
+	bool equal = loaded;
+	if (!loaded) {
+		printf("%-40s could not load\n", check.c_str());
+	}
+	bool stopped[LANES] = { false };
+	for (int f = 0; f < frames && equal; ++f) {
+		for (int lane = 0; lane < LANES; ++lane) {
+			for (int k = 0; k < 16; ++k) {
+				lanes->key[lane][k] = machines[lane].key[k] = (unsigned char)((f / 5 + k + lane) % 7 == 0);
+			}
+		}
+		lanes->runFrame(cyclesPerFrame);
+		for (int lane = 0; lane < LANES && equal; ++lane) {
+			if (stopped[lane]) {
+				continue;
+			}
+			chip8& machine = machines[lane];
+			bool invalid = machine.runFrame(cyclesPerFrame) == chip8::RUN_INVALID_OPCODE;
+			unsigned short expected[40] = { 0 }, actual[40] = { 0 };
+			machine.getRegisters(expected);
+			lanes->getRegisters(lane, actual);
+			if (lanes->getState(lane) == chip8_lanes::LANE_INVALID && !invalid) {
+				printf("%-40s lane %i stopped on %04X, which lanes don't model\n", check.c_str(), lane, actual[32]);
+				delete lanes;
+				return true;
+			}
+			stopped[lane] = invalid;
+			if (memcmp(expected, actual, sizeof(expected)) != 0 || machine.getFrameHash() != lanes->getFrameHash(lane) ||
+				machine.cycles_run != lanes->cycles_run[lane] || memcmp(machine.key_read, lanes->key_read[lane], 16) != 0) {
+				printf("%-40s lane %i differs from chip8 after frame %i\n", check.c_str(), lane, f + 1);
+				equal = false;
+			}
+			memset(machine.key_read, 0, sizeof(machine.key_read));
+			memset(lanes->key_read[lane], 0, sizeof(lanes->key_read[lane]));
+		}
+	}
+	delete lanes;
+	return equal;
+}
+
+//Read a whole file, false if it can't be opened
+bool readFile(const char* path, std::vector<uint8_t>& data) {
+	#pragma warning(suppress : 4996)
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) {
+		return false;
+	}
+	data.clear();
+	for (int c = fgetc(file); c != EOF; c = fgetc(file)) {
+		data.push_back((uint8_t)c);
+	}
+	fclose(file);
+	return true;
+}
+
+//Nanoseconds per load of rom, from its file at path or, with no path, from the copy already in memory
+void benchLoad(const std::string& name, const char* path, const std::vector<uint8_t>& rom) {
+	const int LOADS = 10;
+	chip8 machine;
+	std::vector<double> samples;
+	for (int s = 0; s <= SAMPLES; ++s) {
+		double start = now();
+		for (int i = 0; i < LOADS; ++i) {
+			if (!(path == NULL ? machine.loadFromBuffer(rom.data(), rom.size()) : machine.loadApplication(path))) {
+				return;
+			}
+		}
+		if (s > 0) {
+			samples.push_back((now() - start) * 1e9 / LOADS);
+		}
+	}
+	report(name, "ns/load", samples);
+}
+
+//Nanoseconds per clone into a machine that ran the same ROM, and per state hash after a frame has been run
+void benchClone(const std::vector<uint8_t>& rom) {
+	const int CLONES = 1000;
+	chip8 machine, copy;
+	if (!machine.loadFromBuffer(rom.data(), rom.size()) || !copy.loadFromBuffer(rom.data(), rom.size())) {
+		return;
+	}
+	machine.runFrame(500 / 60);
+	std::vector<double> clones, hashes;
+	uint64_t sum = 0;
+	for (int s = 0; s <= SAMPLES; ++s) {
+		double start = now();
+		for (int i = 0; i < CLONES; ++i) {
+			machine.clone(copy);
+		}
+		double cloned = now();
+		for (int i = 0; i < CLONES; ++i) {
+			copy.runCycles(1);
+			sum += copy.getStateHash();
+		}
+		if (s > 0) {
+			clones.push_back((cloned - start) * 1e9 / CLONES);
+			hashes.push_back((now() - cloned) * 1e9 / CLONES);
+		}
+	}
+	report("clone", "ns/clone", clones);
+	report("getStateHash after one cycle", "ns/hash", hashes);
+	if (sum == 1) {
+		printf("\n"); //Keeps the hashes from being optimized away
+	}
+}
+
+//Machines per second through a breadth-first search that forks every machine on each of the 16 keys, runs a frame
+//and keeps only states it hasn't seen. rom waits for a key and adds it to a register, so many paths meet.
+void benchSearch(const std::vector<uint8_t>& rom, int depth) {
+	chip8 root;
+	if (!root.loadFromBuffer(rom.data(), rom.size())) {
+		return;
+	}
+	std::vector<chip8> machines(2 + 16 * 64); //Root, the node being expanded, then every kept child
+	state_table seen;
+	std::vector<double> samples;
+	size_t explored = 0;
+	for (int s = 0; s <= SAMPLES; ++s) {
+		double start = now();
+		seen.clear();
+		seen.insert(root.getStateHash());
+		std::vector<size_t> frontier(1, 0);
+		root.clone(machines[0]);
+		explored = 0;
+		for (int level = 0; level < depth; ++level) {
+			std::vector<size_t> next;
+			size_t free = 2 + (level % 2) * 16 * 32; //Levels alternate between two halves of the pool
+			for (size_t f = 0; f < frontier.size(); ++f) {
+				machines[frontier[f]].clone(machines[1]);
+				for (int k = 0; k < 16; ++k) {
+					chip8& child = machines[free];
+					machines[1].clone(child);
+					memset(child.key, 0, sizeof(child.key));
+					child.key[k] = 1;
+					child.runFrame(500 / 60);
+					++explored;
+					if (seen.insert(child.getStateHash()) && next.size() < 16 * 32) {
+						next.push_back(free++);
+					}
+				}
+			}
+			frontier.swap(next);
+		}
+		if (s > 0) {
+			samples.push_back(explored / (now() - start));
+		}
+	}
+	report("search " + std::to_string(explored) + " machines, " + std::to_string(seen.size()) + " kept", "machines/s", samples);
+}
+
+#if defined(BENCH_SDL)
+//Frames per second of the SDL display path: one frame of emulation, expanding the display, one texture upload, one scaled copy and a present
+void benchRender(const std::vector<uint8_t>& rom, unsigned long cyclesPerFrame) {
+	const int FRAMES = 60;
+	SDL_setenv("SDL_VIDEODRIVER", "dummy", 0); //Headless unless the caller picked a driver
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		printf("SDL could not initialize! SDL_Error: %s\n", SDL_GetError());
+		return;
+	}
+	SDL_Window* window = SDL_CreateWindow("OctoChip-8 Bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, 512, 256, 0);
+	SDL_Renderer* renderer = window != NULL ? SDL_CreateRenderer(window, -1, 0) : NULL;
+	SDL_Texture* texture = renderer != NULL ? SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, chip8::MAX_WIDTH, chip8::MAX_HEIGHT) : NULL;
+	chip8 machine;
+	if (texture == NULL) {
+		printf("Render path could not be created! SDL_Error: %s\n", SDL_GetError());
+	} else if (machine.loadFromBuffer(rom.data(), rom.size())) {
+		SDL_Rect screen = { 0, 0, 512, 256 };
+		Uint32 pixels[chip8::MAX_WIDTH * chip8::MAX_HEIGHT];
+		std::vector<double> samples;
+		for (int s = 0; s <= SAMPLES; ++s) {
+			double start = now();
+			for (int f = 0; f < FRAMES; ++f) {
+				machine.runFrame(cyclesPerFrame);
+				machine.getPixelsRGBA(pixels, 0xFFFFFFFF, 0xFF000000);
+				SDL_Rect display = { 0, 0, machine.getWidth(), machine.getHeight() };
+				for (int y = 0; y < display.h; ++y) { //Only the rows the frame changed are uploaded
+					if ((machine.dirty_rows >> y) & 1) {
+						SDL_Rect row = { 0, y, display.w, 1 };
+						SDL_UpdateTexture(texture, &row, pixels + y * display.w, display.w * sizeof(Uint32));
+					}
+				}
+				machine.dirty_rows = 0;
+				SDL_RenderCopy(renderer, texture, &display, &screen);
+				SDL_RenderPresent(renderer);
+			}
+			if (s > 0) {
+				samples.push_back(FRAMES / (now() - start));
+			}
+		}
+		report("render frames", "frames/s", samples);
+	}
+	SDL_DestroyTexture(texture);
+	SDL_DestroyRenderer(renderer);
+	SDL_DestroyWindow(window);
+	SDL_Quit();
+}
+#endif
+
+//Write a string as a JSON string
+void writeJsonString(FILE* file, const std::string& text) {
+	fputc('"', file);
+	for (size_t i = 0; i < text.size(); ++i) {
+		unsigned char c = text[i];
+		if (c == '"' || c == '\\') {
+			fprintf(file, "\\%c", c);
+		} else if (c < 0x20) {
+			fprintf(file, "\\u%04x", c);
+		} else {
+			fputc(c, file);
+		}
+	}
+	fputc('"', file);
+}
+
+//Write every result as one JSON document
+bool writeResults(const char* path, const char* label) {
+	#pragma warning(suppress : 4996)
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		return false;
+	}
+	fprintf(file, "{\n\"label\": ");
+	writeJsonString(file, label);
+	fprintf(file, ",\n\"samples\": %i,\n\"results\": [\n", SAMPLES);
+	for (size_t i = 0; i < results.size(); ++i) {
+		const result& r = results[i];
+		fprintf(file, "{\"name\": ");
+		writeJsonString(file, r.name);
+		fprintf(file, ", \"unit\": \"%s\", \"median\": %.3f, \"p10\": %.3f, \"p90\": %.3f, \"min\": %.3f, \"max\": %.3f, \"samples\": %i}%s\n",
+			r.unit, r.median, r.p10, r.p90, r.min, r.max, r.samples, i + 1 < results.size() ? "," : "");
+	}
+	fprintf(file, "]\n}\n");
+	return fclose(file) == 0;
+}
+
+//Main
+int main(int argc, char** argv) {
+	printf("OctoChip-8 Benchmarks\n\n");
+
+	//Check if enough arguments are supplied
+	if (argc < 2) {
+		printf("Usage: octochip-8-bench <results.json> [--label text] [ROM path ...]\n");
+		return 1;
+	}
+	const char* label = "";
+	std::vector<const char*> roms;
+	for (int i = 2; i < argc; ++i) {
+		if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+			label = argv[++i];
+		} else {
+			roms.push_back(argv[i]);
+		}
+	}
+
+	//Register and skip opcodes, the common case for the dispatch loop
+	std::vector<unsigned short> setup;
+	setup.push_back(0x6001); //V0 = 01
+	setup.push_back(0x6102); //V1 = 02
+	setup.push_back(0xA300); //I = 300
+	std::vector<unsigned short> alu;
+	alu.push_back(0x7001); //V0 += 01
+	alu.push_back(0x8014); //V0 += V1
+	alu.push_back(0x30FF); //Skip if V0 == FF
+	alu.push_back(0x8102); //V1 &= V0
+	alu.push_back(0xF01E); //I += V0
+	alu.push_back(0x4000); //Skip if V0 != 00
+	alu.push_back(0x8206); //V2 >>= 1
+	alu.push_back(0x6305); //V3 = 05
+	std::vector<uint8_t> rom = romBytes(unrolled(setup, alu));
+	benchInstructions("alu emulateCycle", rom, true, false, 100000);
+	benchInstructions("alu runCycles", rom, false, false, 1000000);
+	benchInstructions("alu runCycles jit", rom, false, true, 1000000);
+	benchLoad("loadFromBuffer synthetic", NULL, rom);
+
+	benchClone(rom);
+
+	//Search over key presses
+	std::vector<unsigned short> adder;
+	adder.push_back(0xF00A); //V0 = key
+	adder.push_back(0x8104); //V1 += V0
+	adder.push_back(0x1200); //Loop
+	benchSearch(romBytes(adder), 3);
+
+	//DXYN by sprite height, drawn at (1, 2) from the ROM's own bytes
+	for (int height = 1; height <= 15; ++height) {
+		std::vector<unsigned short> draw(1, (unsigned short)(0xD010 | height));
+		char name[32];
+		snprintf(name, sizeof(name), "DXYN height %i", height);
+		benchInstructions(name, romBytes(unrolled(setup, draw)), false, false, 200000);
+	}
+
+	//00E0
+	benchInstructions("00E0", romBytes(unrolled(setup, std::vector<unsigned short>(1, 0x00E0))), false, false, 200000);
+
+	//Idle loops, fast-forwarded to the next timer tick every frame. Stepping through them one instruction at a time
+	//is what the frame would cost without it.
+	std::vector<unsigned short> wait;
+	wait.push_back(0x6AFF); //VA = FF
+	wait.push_back(0xFA15); //Delay timer = VA
+	wait.push_back(0xF007); //V0 = delay timer
+	wait.push_back(0x3000); //Skip if V0 == 00
+	wait.push_back(0x1204); //Loop
+	wait.push_back(0x120A); //Jump to self
+	const unsigned long fast = 1000000 / 60;
+	benchFrames("idle delay poll runFrame", romBytes(wait), false, false, fast, 120);
+	benchFrames("idle delay poll runFrame jit", romBytes(wait), false, true, fast, 120);
+	benchFrames("idle delay poll emulateCycle", romBytes(wait), true, false, fast, 120);
+
+	//The JIT has to leave every machine exactly where the interpreter does, idle loops included. Cycle counts that
+	//aren't multiples of the poll loop's length end frames on each of its instructions.
+	bool equivalent = true;
+	std::vector<unsigned short> spin(wait);
+	spin[0] = 0x6A05; //VA = 05, so the poll ends every few frames
+	spin[5] = 0x7101; //V1 += 01, instead of the jump to self
+	spin.push_back(0x1200); //Start the poll again
+	const unsigned long speeds[] = { 7, 500 / 60, 1000 / 60, 100000 / 60 };
+	for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); ++i) {
+		equivalent &= checkJit("jit check alu", romBytes(unrolled(setup, alu)), 120, speeds[i]);
+		equivalent &= checkJit("jit check idle delay poll", romBytes(wait), 120, speeds[i]);
+		equivalent &= checkJit("jit check repeated delay poll", romBytes(spin), 120, speeds[i]);
+		equivalent &= checkJit("jit check key wait", romBytes(adder), 120, speeds[i]);
+	}
+
+	//chip8_lanes, against 32 chip8s and checked against them lane by lane under every quirk profile. The fuzz ROM
+	//draws, shifts, skips on keys and stores and loads registers at random values, so lanes drift apart.
+	std::vector<unsigned short> fuzz;
+	fuzz.push_back(0xC03F); //V0 = random & 3F
+	fuzz.push_back(0xC11F); //V1 = random & 1F
+	fuzz.push_back(0xD015); //Draw at V0, V1
+	fuzz.push_back(0xC2FF); //V2 = random
+	fuzz.push_back(0x8216); //V2 >>= 1, or V2 = V1 >> 1
+	fuzz.push_back(0x832E); //V3 <<= 1, or V3 = V2 << 1
+	fuzz.push_back(0x8421); //V4 |= V2
+	fuzz.push_back(0xE09E); //Skip if key V0 is pressed
+	fuzz.push_back(0x7501); //V5 += 01
+	fuzz.push_back(0xA0A0); //I = 0A0, in the big font
+	fuzz.push_back(0xF255); //Store V0 to V2
+	fuzz.push_back(0xF265); //Load V0 to V2
+	fuzz.push_back(0xA300); //I = 300
+	std::vector<unsigned short> jump;
+	jump.push_back(0x6002); //V0 = 02
+	jump.push_back(0x6204); //V2 = 04
+	jump.push_back(0xB20A); //Jump to 20C, or 20E with the jump quirk
+	jump.push_back(0x0000);
+	jump.push_back(0x0000);
+	jump.push_back(0x0000);
+	jump.push_back(0x7101); //V1 += 01
+	jump.push_back(0x7301); //V3 += 01
+	jump.push_back(0x1204); //Loop
+	benchLanes("alu runFrame", romBytes(unrolled(setup, alu)), 100000 / 60, 10);
+	benchLanes("fuzz runFrame", romBytes(unrolled(setup, fuzz)), 100000 / 60, 10);
+	const chip8::quirk_profile profiles[] = { chip8::QUIRKS_OCTOCHIP, chip8::QUIRKS_VIP, chip8::QUIRKS_SCHIP, chip8::QUIRKS_XOCHIP };
+	for (size_t i = 0; i < sizeof(profiles) / sizeof(profiles[0]); ++i) {
+		equivalent &= checkLanes("alu", romBytes(unrolled(setup, alu)), profiles[i], 60, 1000 / 60);
+		equivalent &= checkLanes("fuzz", romBytes(unrolled(setup, fuzz)), profiles[i], 60, 1000 / 60);
+		equivalent &= checkLanes("jump", romBytes(jump), profiles[i], 10, 1000 / 60);
+		equivalent &= checkLanes("key wait", romBytes(adder), profiles[i], 60, 1000 / 60);
+		equivalent &= checkLanes("idle delay poll", romBytes(spin), profiles[i], 60, 1000 / 60);
+	}
+
+	#if defined(BENCH_SDL)
+	//Sprites moving across the screen, so every frame draws
+	std::vector<unsigned short> sprites;
+	sprites.push_back(0xD015); //Draw at V0, V1
+	sprites.push_back(0x7003); //V0 += 03
+	sprites.push_back(0x7101); //V1 += 01
+	benchRender(romBytes(unrolled(setup, sprites)), 500 / 60);
+	#endif
+
+	//Real ROMs, run the way the frontends do
+	for (size_t i = 0; i < roms.size(); ++i) {
+		std::string name = roms[i];
+		name = name.substr(name.find_last_of("/\\") + 1);
+		if (!readFile(roms[i], rom)) {
+			printf("Could not read %s\n", roms[i]);
+			continue;
+		}
+		benchInstructions(name + " runCycles", rom, false, false, 1000000);
+		benchLoad(name + " loadApplication", roms[i], rom);
+		benchLoad(name + " loadFromBuffer", NULL, rom);
+		equivalent &= checkJit(name + " jit check", rom, 600, 500 / 60);
+		benchLanes(name + " runFrame", rom, 100000 / 60, 10);
+		equivalent &= checkLanes(name, rom, chip8::QUIRKS_OCTOCHIP, 600, 500 / 60);
+	}
+
+	if (!writeResults(argv[1], label)) {
+		printf("Could not write results %s\n", argv[1]);
+		return 1;
+	}
+	if (!equivalent) {
+		printf("The JIT or the lanes disagree with the interpreter\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "../octochip-8/chip8.h"
+#include "../octochip-8/input_record.h"
+#include "../octochip-8/mapped_file.h"
+#include "../octochip-8/thread_pool.h"
+
+//Golden manifest lines look like "<ROM path> <input script or -> <frame>=<hash> ...", # starts a comment.
+//Each ROM runs until its last listed frame, speed / 60 cycles a frame with input applied at the start of each frame,
+//exactly like the batch runner and the SDL frontend, and the display hash from getFrameHash is checked after every
+//listed frame. Frame 0 is the display before the first frame runs. A hash of ? is never checked, so a new manifest
+//can be written with ? everywhere and filled in with --write. Input scripts are input_record files and can set the
+//seed, speed and quirks of their ROM.
+
+//A frame whose display hash is checked
+struct checkpoint {
+	unsigned long frame; //Frames run before the display is hashed
+	bool known; //False for ?, the hash is only recorded
+	uint64_t expected; //Golden hash
+	uint64_t actual; //Hash the run produced
+};
+
+//One manifest line and its result
+struct rom_test {
+	std::string rom; //ROM path
+	std::string script; //Input script path, empty for none
+	std::vector<checkpoint> checkpoints; //In frame order
+	const char* error; //Why the ROM couldn't be run, NULL if it ran
+	size_t mismatches; //Known checkpoints whose hash differed
+};
+
+int speed = 500; //Cycles per second for ROMs whose script doesn't set one
+uint32_t seed = 1; //CXNN seed for ROMs whose script doesn't set one
+chip8::quirk_profile quirks = chip8::QUIRKS_OCTOCHIP; //Quirk profile for ROMs whose script doesn't set one
+
+//Milliseconds since an arbitrary point
+long long nowMs() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Read a golden manifest, false if it can't be opened or a line is malformed
+bool loadManifest(const char* path, std::vector<rom_test>& tests) {
+	#pragma warning(suppress : 4996)
+	FILE* file = fopen(path, "r");
+	if (file == NULL) {
+		printf("Could not open manifest %s\n", path);
+		return false;
+	}
+	char line[4096];
+	int number = 0;
+	bool valid = true;
+	while (fgets(line, sizeof(line), file) != NULL) {
+		++number;
+		char* token = strtok(line, " \t\r\n");
+		if (token == NULL || token[0] == '#') {
+			continue;
+		}
+		rom_test t;
+		t.rom = token;
+		t.error = NULL;
+		t.mismatches = 0;
+		token = strtok(NULL, " \t\r\n");
+		if (token != NULL && strcmp(token, "-") != 0) {
+			t.script = token;
+		}
+		while ((token = strtok(NULL, " \t\r\n")) != NULL) {
+			checkpoint c;
+			char hash[32] = { 0 };
+			#pragma warning(suppress : 4996)
+			if (sscanf(token, "%lu=%31s", &c.frame, hash) != 2) {
+				printf("%s:%i: bad checkpoint %s, expected <frame>=<hash>\n", path, number, token);
+				valid = false;
+				break;
+			}
+			c.known = strcmp(hash, "?") != 0;
+			c.expected = c.known ? strtoull(hash, NULL, 16) : 0;
+			c.actual = 0;
+			t.checkpoints.push_back(c);
+		}
+		if (t.checkpoints.empty()) {
+			printf("%s:%i: %s has no checkpoints\n", path, number, t.rom.c_str());
+			valid = false;
+			continue;
+		}
+		std::stable_sort(t.checkpoints.begin(), t.checkpoints.end(), [](const checkpoint& a, const checkpoint& b) { return a.frame < b.frame; });
+		tests.push_back(t);
+	}
+	fclose(file);
+	return valid;
+}
+
+//Run one ROM on a worker's machine and hash the display at each checkpoint. A machine that hits an unknown
+//opcode stays stopped, so later checkpoints see its last display, like the SDL frontend.
+void runTest(rom_test& t, chip8& machine) {
+	input_record input;
+	input.clear(seed, speed);
+	input.quirks = chip8::quirksName(quirks);
+	if (!t.script.empty() && !input.load(t.script.c_str())) {
+		t.error = "could not read input script";
+		return;
+	}
+	chip8::quirk_profile profile;
+	if (!chip8::findQuirks(input.quirks.c_str(), profile)) {
+		t.error = "unknown quirk profile";
+		return;
+	}
+	machine.setQuirks(profile);
+	machine.seed(input.seed);
+	mapped_file rom; //Loaded from memory, so a whole library doesn't print a line per ROM
+	if (!rom.open(t.rom.c_str()) || !machine.loadFromBuffer(rom.data(), rom.size())) {
+		t.error = "could not load ROM";
+		return;
+	}
+
+	int frame_speed = std::max(1, input.speed);
+	int cycle_debt = 0; //Cycles carried between frames, in 1/60ths of a cycle
+	unsigned long long cycles = 0; //Cycles every frame was given, input is replayed against these
+	unsigned long frame = 0;
+	bool stopped = false;
+	for (size_t c = 0; c < t.checkpoints.size(); ++c) {
+		checkpoint& check = t.checkpoints[c];
+		for (; frame < check.frame && !stopped; ++frame) {
+			unsigned short keys = input.replay(cycles);
+			for (int i = 0; i < 16; ++i) {
+				machine.key[i] = (keys >> i) & 1;
+			}
+			cycle_debt += frame_speed;
+			unsigned long budget = cycle_debt / 60;
+			cycle_debt %= 60;
+			stopped = machine.runFrame(budget) == chip8::RUN_INVALID_OPCODE;
+			cycles += budget;
+		}
+		check.actual = machine.getFrameHash();
+		if (check.known && check.actual != check.expected) {
+			++t.mismatches;
+		}
+	}
+}
+
+//Write the manifest back with every hash replaced by the one the run produced, false if it can't be written
+bool writeManifest(const char* path, const std::vector<rom_test>& tests) {
+	#pragma warning(suppress : 4996)
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		return false;
+	}
+	for (size_t i = 0; i < tests.size(); ++i) {
+		const rom_test& t = tests[i];
+		fprintf(file, "%s %s", t.rom.c_str(), t.script.empty() ? "-" : t.script.c_str());
+		for (size_t c = 0; c < t.checkpoints.size(); ++c) {
+			fprintf(file, " %lu=%016llx", t.checkpoints[c].frame, (unsigned long long)t.checkpoints[c].actual);
+		}
+		fprintf(file, "\n");
+	}
+	return fclose(file) == 0;
+}
+
+//Main
+int main(int argc, char** argv) {
+	printf("OctoChip-8 Conformance Runner\n\n");
+
+	//Check if enough arguments are supplied
+	if (argc < 2) {
+		printf("Usage: octochip-8-conformance <golden manifest> [--threads N] [--speed cycles/s] [--seed hex] [--quirks profile] [--jit] [--write manifest]\n");
+		return 1;
+	}
+
+	unsigned threads = 0;
+	bool use_jit = false;
+	const char* writePath = NULL; //Manifest to write the hashes the run produced to
+	for (int i = 2; i < argc; ++i) {
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			if (!thread_pool::parseThreads(argv[++i], threads)) {
+				printf("Bad thread count %s, use 0 for one per core\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+			speed = std::max(1, atoi(argv[++i]));
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = (uint32_t)strtoul(argv[++i], NULL, 16);
+		} else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+			if (!chip8::findQuirks(argv[++i], quirks)) {
+				printf("Unknown quirk profile %s, use octochip, vip, schip or xochip\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--write") == 0 && i + 1 < argc) {
+			writePath = argv[++i];
+		} else if (strcmp(argv[i], "--jit") == 0) {
+			use_jit = true;
+		} else {
+			printf("%s: %s\n", i + 1 < argc ? "Unknown option" : "Unknown option or missing value", argv[i]);
+			return 1;
+		}
+	}
+
+	std::vector<rom_test> tests;
+	if (!loadManifest(argv[1], tests)) {
+		return 1;
+	}
+
+	thread_pool pool(threads);
+	std::vector<chip8> machines(pool.size()); //One machine per worker, reused for every ROM it runs
+	for (unsigned w = 0; w < pool.size() && use_jit; ++w) {
+		if (!machines[w].enableJit(true)) {
+			printf("JIT not available on this host, interpreting.\n");
+			use_jit = false;
+		}
+	}
+	long long start = nowMs();
+	pool.run(tests.size(), [&](size_t index, unsigned worker) {
+		runTest(tests[index], machines[worker]);
+	});
+	long long elapsed = nowMs() - start;
+
+	//Only failures are listed, in manifest order
+	size_t failed = 0;
+	size_t checked = 0;
+	for (size_t i = 0; i < tests.size(); ++i) {
+		const rom_test& t = tests[i];
+		if (t.error != NULL) {
+			printf("ERROR %s: %s\n", t.rom.c_str(), t.error);
+			++failed;
+			continue;
+		}
+		for (size_t c = 0; c < t.checkpoints.size(); ++c) {
+			const checkpoint& check = t.checkpoints[c];
+			checked += check.known ? 1 : 0;
+			if (check.known && check.actual != check.expected) {
+				printf("FAIL  %s: frame %lu hash %016llx, expected %016llx\n", t.rom.c_str(), check.frame,
+					(unsigned long long)check.actual, (unsigned long long)check.expected);
+			}
+		}
+		failed += t.mismatches > 0 ? 1 : 0;
+	}
+	if (writePath != NULL && !writeManifest(writePath, tests)) {
+		printf("Could not write manifest %s\n", writePath);
+		return 1;
+	}
+	printf("\n%u of %u ROMs passed, %u frames checked on %u threads in %lli ms.\n", (unsigned)(tests.size() - failed), (unsigned)tests.size(),
+		(unsigned)checked, pool.size(), elapsed);
+	return failed == 0 ? 0 : 1;
+}
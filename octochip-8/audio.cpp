@@ -0,0 +1,111 @@
+#include <string.h>
+#include "audio.h"
+
+//Silent wave at frequency Hz, sampled rate times a second
+square_wave::square_wave(int rate, int frequency, int16_t amplitude) : phase(0), amplitude(amplitude), on(false) {
+	step = (uint32_t)(((uint64_t)frequency << 32) / (uint64_t)rate);
+}
+
+//Render count samples covering the cycles emulated cycles from start, switching at each of the events. An event
+//stamped at the end of the frame, like the sound timer running out as the timers tick, takes effect in the next one.
+void square_wave::render(int16_t samples[], size_t count, const chip8_sound_event events[], int event_count, uint64_t start, uint64_t cycles) {
+	size_t done = 0;
+	for (int e = 0; e <= event_count; ++e) {
+		size_t until = count;
+		if (e < event_count) {
+			uint64_t offset = events[e].cycle > start ? events[e].cycle - start : 0;
+			until = offset >= cycles ? (cycles == 0 ? 0 : count) : (size_t)(offset * count / cycles);
+			until = until < done ? done : until;
+		}
+		for (; done < until; ++done) {
+			if (on) {
+				samples[done] = (phase & 0x80000000) ? (int16_t)-amplitude : amplitude;
+				phase += step;
+			} else {
+				samples[done] = 0;
+			}
+		}
+		if (e < event_count) {
+			on = events[e].on;
+		}
+	}
+}
+
+//Write a value as little-endian bytes, returns the position after it
+static unsigned char* putValue(unsigned char* out, uint32_t value, int bytes) {
+	for (int i = 0; i < bytes; ++i) {
+		out[i] = (unsigned char)(value >> (i * 8));
+	}
+	return out + bytes;
+}
+
+//Not open
+wav_writer::wav_writer() : file(NULL), written(0), failed(false) {}
+
+//Closes the file if it's open
+wav_writer::~wav_writer() {
+	close();
+}
+
+//Start a file of rate samples a second, false if it can't be created. The header is written with empty sizes
+//that close fills in.
+bool wav_writer::open(const char* path, int rate) {
+	close();
+	#pragma warning(suppress : 4996)
+	file = fopen(path, "wb");
+	if (file == NULL) {
+		return false;
+	}
+	written = 0;
+	unsigned char header[44];
+	unsigned char* out = header;
+	memcpy(out, "RIFF", 4); out += 4;
+	out = putValue(out, 36, 4);
+	memcpy(out, "WAVEfmt ", 8); out += 8;
+	out = putValue(out, 16, 4); //Format chunk size
+	out = putValue(out, 1, 2); //PCM
+	out = putValue(out, 1, 2); //Mono
+	out = putValue(out, (uint32_t)rate, 4);
+	out = putValue(out, (uint32_t)rate * 2, 4); //Bytes a second
+	out = putValue(out, 2, 2); //Bytes a sample
+	out = putValue(out, 16, 2); //Bits a sample
+	memcpy(out, "data", 4); out += 4;
+	out = putValue(out, 0, 4);
+	failed = fwrite(header, 1, sizeof(header), file) != sizeof(header);
+	return !failed;
+}
+
+//Append samples, false if they can't be written
+bool wav_writer::write(const int16_t samples[], size_t count) {
+	if (file == NULL) {
+		return false;
+	}
+	unsigned char buffer[1024];
+	for (size_t i = 0; i < count; ) {
+		unsigned char* out = buffer;
+		size_t chunk = 0;
+		for (; chunk < sizeof(buffer) / 2 && i < count; ++chunk, ++i) {
+			out = putValue(out, (uint16_t)samples[i], 2);
+		}
+		if (fwrite(buffer, 2, chunk, file) != chunk) {
+			failed = true;
+		}
+		written += (uint32_t)chunk;
+	}
+	return !failed;
+}
+
+//Fill in the sizes in the header and close, false if the file is bad
+bool wav_writer::close() {
+	if (file == NULL) {
+		return false;
+	}
+	unsigned char size[4];
+	putValue(size, 36 + written * 2, 4);
+	failed |= fseek(file, 4, SEEK_SET) != 0 || fwrite(size, 1, 4, file) != 4;
+	putValue(size, written * 2, 4);
+	failed |= fseek(file, 40, SEEK_SET) != 0 || fwrite(size, 1, 4, file) != 4;
+	failed |= fclose(file) != 0;
+	file = NULL;
+	return !failed;
+}
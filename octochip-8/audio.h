@@ -0,0 +1,42 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "chip8.h"
+
+//The buzzer as a square wave, rendered one frame at a time from the sound events the frame produced. Each event
+//switches the tone at the sample matching how far into the frame's emulated cycles it happened, and the phase
+//carries over between frames so the wave has no clicks at frame boundaries.
+class square_wave {
+public:
+	square_wave(int rate, int frequency, int16_t amplitude); //Silent wave at frequency Hz, sampled rate times a second
+
+	//Render count samples covering the cycles emulated cycles from start, switching at each of the events
+	void render(int16_t samples[], size_t count, const chip8_sound_event events[], int event_count, uint64_t start, uint64_t cycles);
+	bool playing() const { return on; } //True while the buzzer is sounding
+
+private:
+	uint32_t step; //Phase added per sample, a full period is 2^32
+	uint32_t phase; //Position in the period, the wave is high in the first half
+	int16_t amplitude;
+	bool on; //Buzzer state after the last event rendered
+};
+
+//Writes 16-bit mono samples to a WAV file, so audio can be checked and measured without a sound device
+class wav_writer {
+public:
+	wav_writer(); //Not open
+	~wav_writer(); //Closes the file if it's open
+
+	bool open(const char* path, int rate); //Start a file of rate samples a second, false if it can't be created
+	bool write(const int16_t samples[], size_t count); //Append samples, false if they can't be written
+	bool close(); //Fill in the sizes in the header and close, false if the file is bad
+
+private:
+	FILE* file; //NULL when not open
+	uint32_t written; //Samples written so far
+	bool failed; //A write went wrong since open
+
+	wav_writer(const wav_writer&);
+	wav_writer& operator=(const wav_writer&);
+};
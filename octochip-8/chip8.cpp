@@ -1,9 +1,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <time.h>
 //#include <Windows.h>
 #include "chip8.h"
+#include "chip8_ops.h"
+#include "chip8_jit.h"
+#include "chip8_profile.h"
 
 //Fonstset
 unsigned char chip8_fontset[80] = {
@@ -25,6 +27,49 @@ unsigned char chip8_fontset[80] = {
   0xF0, 0x80, 0xF0, 0x80, 0x80  // F
 };
 
+//SCHIP 8x10 fontset, loaded after the small one so FX30 can point I at it
+unsigned char chip8_bigfont[160] = {
+  0xFF, 0xFF, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, // 0
+  0x18, 0x78, 0x78, 0x18, 0x18, 0x18, 0x18, 0x18, 0xFF, 0xFF, // 1
+  0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // 2
+  0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 3
+  0xC3, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0x03, 0x03, // 4
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 5
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 6
+  0xFF, 0xFF, 0x03, 0x03, 0x06, 0x0C, 0x18, 0x18, 0x18, 0x18, // 7
+  0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, // 8
+  0xFF, 0xFF, 0xC3, 0xC3, 0xFF, 0xFF, 0x03, 0x03, 0xFF, 0xFF, // 9
+  0x7E, 0xFF, 0xC3, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+  0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, 0xC3, 0xC3, 0xFC, 0xFC, // B
+  0x3C, 0xFF, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0xFF, 0x3C, // C
+  0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, // E
+  0xFF, 0xFF, 0xC0, 0xC0, 0xFF, 0xFF, 0xC0, 0xC0, 0xC0, 0xC0  // F
+};
+const unsigned short BIGFONT_ADDRESS = 0x50; //Where chip8_bigfont is loaded
+
+//Construct without a JIT
+chip8::chip8() {
+	jit = NULL;
+	profile = NULL;
+	quirks = QUIRKS_OCTOCHIP;
+	rng = rng_seed = 1;
+	hires = false;
+	hashed = false;
+	sound_timer = 0;
+	cycles_total = 0;
+	sound_event_count = 0;
+	memset(key_read, 0, sizeof(key_read));
+	//decoded isn't part of the state clone copies, it has to match memory from the start for clone to only redecode what differs
+	memset(memory, 0, sizeof(memory));
+	memset(decoded, 0, sizeof(decoded));
+}
+
+//Free the JIT
+chip8::~chip8() {
+	delete jit;
+}
+
 //Returns the registers and stack
 void chip8::getRegisters(unsigned short values[]) {
 	int i = 0;
@@ -38,39 +83,170 @@ void chip8::getRegisters(unsigned short values[]) {
 	values[39] = sound_timer;
 }
 
+//Expand the display to one byte per pixel, 1 if lit
+void chip8::getPixels(unsigned char pixels[]) {
+	int width = getWidth();
+	for (int y = 0; y < getHeight(); ++y) {
+		for (int x = 0; x < width; ++x) {
+			pixels[x + (y * width)] = (gfx[y][x >> 6] >> (63 - (x & 63))) & 1;
+		}
+	}
+}
+
+//Expand the display to one colour per pixel
+void chip8::getPixelsRGBA(uint32_t pixels[], uint32_t on, uint32_t off) {
+	int width = getWidth();
+	for (int y = 0; y < getHeight(); ++y) {
+		for (int x = 0; x < width; ++x) {
+			uint32_t lit = 0 - (uint32_t)((gfx[y][x >> 6] >> (63 - (x & 63))) & 1);
+			pixels[x + (y * width)] = off ^ ((on ^ off) & lit);
+		}
+	}
+}
+
+const uint64_t FNV_OFFSET = 14695981039346656037ULL; //FNV-1a 64-bit offset basis
+const uint64_t FNV_PRIME = 1099511628211ULL; //FNV-1a 64-bit prime
+
+//Hash the first words of each display row, left to right and top to bottom so the hash is the same on any host
+static uint64_t hashRows(uint64_t hash, const uint64_t rows[][2], int count, int words) {
+	for (int y = 0; y < count; ++y) {
+		for (int word = 0; word < words; ++word) {
+			for (int shift = 56; shift >= 0; shift -= 8) {
+				hash = (hash ^ ((rows[y][word] >> shift) & 0xFF)) * FNV_PRIME;
+			}
+		}
+	}
+	return hash;
+}
+
+//FNV-1a hash of the display at the current resolution, low resolution hashes the same as before it existed
+uint64_t chip8::getFrameHash() {
+	return hires ? hashRows(FNV_OFFSET, gfx, 64, 2) : hashRows(FNV_OFFSET, gfx, 32, 1);
+}
+
+//Mix one word into a well spread 64-bit value, the splitmix64 finalizer
+static uint64_t mix(uint64_t value) {
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+	return value ^ (value >> 31);
+}
+
+//Hash of one 8-byte word of memory at its index, read little-endian so the hash is the same on any host
+static uint64_t hashWord(const unsigned char memory[], unsigned int word) {
+	uint64_t value = 0;
+	for (int i = 7; i >= 0; --i) {
+		value = (value << 8) | memory[word * 8 + i];
+	}
+	return mix(value ^ mix(word + 1));
+}
+
+//Toggle the words overlapping memory in or out of memory_hash, call before and after writing them
+void chip8::hashMemory(unsigned short address, unsigned short length) {
+	if (!hashed || length == 0) {
+		return;
+	}
+	unsigned int first = (address & 0xFFF) >> 3;
+	unsigned int last = ((address + length - 1) & 0xFFF) >> 3;
+	for (unsigned int word = first; ; word = (word + 1) & 511) {
+		memory_hash ^= hashWord(memory, word);
+		if (word == last) {
+			break;
+		}
+	}
+}
+
+//Hash of everything that decides what the machine does next. Memory's part is kept up to date as it's written,
+//so only the registers and display are hashed here once memory has been hashed in full.
+uint64_t chip8::getStateHash() {
+	if (!hashed) {
+		memory_hash = 0;
+		for (unsigned int word = 0; word < 512; ++word) {
+			memory_hash ^= hashWord(memory, word);
+		}
+		hashed = true;
+	}
+	uint64_t hash = mix(memory_hash);
+	for (int i = 0; i < 16; i += 8) {
+		uint64_t registers = 0;
+		for (int j = 7; j >= 0; --j) {
+			registers = (registers << 8) | V[i + j];
+		}
+		hash = mix(hash ^ registers);
+	}
+	for (int i = 0; i < 16; i += 4) {
+		hash = mix(hash ^ stack[i] ^ ((uint64_t)stack[i + 1] << 16) ^ ((uint64_t)stack[i + 2] << 32) ^ ((uint64_t)stack[i + 3] << 48));
+	}
+	hash = mix(hash ^ I ^ ((uint64_t)pc << 16) ^ ((uint64_t)sp << 32) ^ ((uint64_t)delay_timer << 48) ^ ((uint64_t)sound_timer << 56));
+	hash = mix(hash ^ rng ^ ((uint64_t)hires << 32));
+	for (int i = 0; i < 16; i += 8) {
+		uint64_t flags = 0;
+		for (int j = 7; j >= 0; --j) {
+			flags = (flags << 8) | rpl[i + j];
+		}
+		hash = mix(hash ^ flags);
+	}
+	if (hires) {
+		for (int y = 0; y < 64; ++y) {
+			hash = mix(mix(hash ^ gfx[y][0]) ^ gfx[y][1]);
+		}
+	} else {
+		for (int y = 0; y < 32; ++y) {
+			hash = mix(hash ^ gfx[y][0]);
+		}
+	}
+	return hash;
+}
+
 //Initialize data
 void chip8::init() {
 	opcode = 0;
 	I = 0;
 	pc = 0x200;
 	delay_timer = 0;
+	if (sound_timer != 0) {
+		noteSound(false, 0);
+	}
 	sound_timer = 0;
 	sp = 0;
-	draw_flag = true;
+	rom_size = 0;
+	hires = false;
+	hashed = false;
+	cycles_run = 0;
+	cycles_skipped = 0;
+	dirty_rows = ALL_ROWS;
 
 	for (int i = 0; i < 4096; ++i) {
 		memory[i] = 0;
 	}
 	for (int i = 0; i < 16; ++i) {
-		V[i] = key[i] = 0;
+		V[i] = key[i] = key_read[i] = 0;
 	}
 	for (int i = 0; i < 16; ++i) {
 		stack[i] = 0;
 	}
-	for (int i = 0; i < 2048; ++i) {
-		gfx[i] = 0;
+	memset(gfx, 0, sizeof(gfx));
+	memset(rpl, 0, sizeof(rpl));
+	memset(decoded, 0, sizeof(decoded));
+	if (jit != NULL) {
+		jit->flush();
 	}
 
 	//Load fontset into memory
 	for (int i = 0; i < 80; ++i) {
 		memory[i] = chip8_fontset[i];
 	}
+	memcpy(memory + BIGFONT_ADDRESS, chip8_bigfont, sizeof(chip8_bigfont));
 
-	//Initialize random generator
-	srand((int)time(NULL));
+	//Restart the random numbers so every run from the same seed is identical
+	rng = rng_seed;
 }
 
-//Load application from file
+//Seed the random numbers CXNN draws, loading an application starts again from this seed
+void chip8::seed(uint32_t seed) {
+	rng = rng_seed = seed != 0 ? seed : 1; //Xorshift never leaves 0
+}
+
+//Load application from file, false if it can't be read or doesn't fit
 bool chip8::loadApplication(const char* filename) {
 	init();
 	printf("Loading file: %s\n", filename);
@@ -82,335 +258,903 @@ bool chip8::loadApplication(const char* filename) {
 		return false;
 	}
 
-	//Get file size
-	fseek(romFile, 0, SEEK_END);
-	rom_size = ftell(romFile);
-	rewind(romFile);
+	//Read straight into memory, anything left over means the ROM doesn't fit
+	rom_size = (unsigned long)fread(memory + 0x200, 1, 4096 - 0x200, romFile);
+	bool fits = fgetc(romFile) == EOF;
+	fclose(romFile);
+	if (!fits) {
+		printf("Error: File too big to fit in memory.\n");
+		init();
+		return false;
+	}
+	return true;
+}
 
-	//Create a buffer to hold the file
-	char* buffer = (char*)malloc(sizeof(char) * rom_size);
-	if (buffer == NULL) {
-		fputs("Error creating buffer to load file", stderr);
+//Load application from memory, false if it doesn't fit
+bool chip8::loadFromBuffer(const uint8_t* data, size_t size) {
+	init();
+	if (size > 4096 - 0x200) {
 		return false;
 	}
+	memcpy(memory + 0x200, data, size);
+	rom_size = (unsigned long)size;
+	return true;
+}
+
+const unsigned char STATE_MAGIC[4] = { 'O', 'C', '8', 'S' }; //First bytes of every save state
+const unsigned short STATE_VERSION = 3; //Bumped whenever the layout changes
+const unsigned long STATE_BLOCK = 64; //Memory is compared and restored in blocks of this many bytes
+
+//Write a value as little-endian bytes, returns the position after it
+static unsigned char* putValue(unsigned char* out, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; ++i) {
+		out[i] = (unsigned char)(value >> (i * 8));
+	}
+	return out + bytes;
+}
+
+//Read a little-endian value, returns the position after it
+static const unsigned char* getValue(const unsigned char* in, uint64_t& value, int bytes) {
+	value = 0;
+	for (int i = 0; i < bytes; ++i) {
+		value |= (uint64_t)in[i] << (i * 8);
+	}
+	return in + bytes;
+}
 
-	//Copy file into buffer
-	#pragma warning(suppress : 6386)
-	size_t result = fread(buffer, 1, rom_size, romFile);
-	if (result != rom_size) {
-		fputs("Error copying file into buffer", stderr);
+//Write the whole machine into buffer, returns STATE_SIZE or 0 if it doesn't fit. Multi-byte values are little-endian.
+unsigned long chip8::saveState(unsigned char buffer[], unsigned long size) {
+	if (size < STATE_SIZE) {
+		return 0;
+	}
+	unsigned char* out = buffer;
+	memcpy(out, STATE_MAGIC, 4);
+	out = putValue(out + 4, STATE_VERSION, 2);
+	out = putValue(out, STATE_SIZE, 2);
+	out = putValue(out, opcode, 2);
+	memcpy(out, memory, sizeof(memory));
+	out += sizeof(memory);
+	memcpy(out, V, sizeof(V));
+	out += sizeof(V);
+	out = putValue(out, I, 2);
+	out = putValue(out, pc, 2);
+	*out++ = delay_timer;
+	*out++ = sound_timer;
+	for (int i = 0; i < 16; ++i) {
+		out = putValue(out, stack[i], 2);
+	}
+	out = putValue(out, sp, 2);
+	out = putValue(out, rom_size, 4);
+	for (int y = 0; y < 64; ++y) {
+		out = putValue(out, gfx[y][0], 8);
+		out = putValue(out, gfx[y][1], 8);
+	}
+	memcpy(out, key, sizeof(key));
+	out += sizeof(key);
+	out = putValue(out, rng, 4);
+	*out++ = hires;
+	memcpy(out, rpl, sizeof(rpl));
+	return STATE_SIZE;
+}
+
+//Restore a machine written by saveState, false if buffer isn't a valid state. Nothing is changed on failure.
+bool chip8::loadState(const unsigned char buffer[], unsigned long size) {
+	uint64_t version = 0, length = 0, value = 0;
+	if (size < STATE_SIZE || memcmp(buffer, STATE_MAGIC, 4) != 0) {
+		return false;
+	}
+	const unsigned char* in = getValue(buffer + 4, version, 2);
+	in = getValue(in, length, 2);
+	if (version != STATE_VERSION || length != STATE_SIZE) {
 		return false;
 	}
 
-	//Copy ROM into memory, if it fits
-	if ((4096 - 512) > rom_size) { // ???? Should this be >= ????
-		for (unsigned long i = 0; i < rom_size; ++i) {
-			#pragma warning(suppress : 6385)
-			memory[i + 0x200] = buffer[i];
+	//Checked before anything is restored, a bad stack pointer would let 00EE read past the stack
+	uint64_t saved_sp = 0;
+	getValue(in + 2 + sizeof(memory) + sizeof(V) + 2 + 2 + 2 + 32, saved_sp, 2);
+	if (saved_sp > 16) {
+		return false;
+	}
+	in = getValue(in, value, 2);
+	opcode = (unsigned short)value;
+
+	//Only blocks that differ are copied, so decoded opcodes and translations elsewhere survive
+	for (unsigned long i = 0; i < sizeof(memory); i += STATE_BLOCK) {
+		if (memcmp(memory + i, in + i, STATE_BLOCK) != 0) {
+			hashMemory((unsigned short)i, (unsigned short)STATE_BLOCK);
+			memcpy(memory + i, in + i, STATE_BLOCK);
+			hashMemory((unsigned short)i, (unsigned short)STATE_BLOCK);
+			invalidate((unsigned short)i, (unsigned short)STATE_BLOCK);
 		}
-	} else {
-		fputs("File too big for memory", stderr);
-		printf("Error: File too big to fit in memory.\n");
 	}
+	in += sizeof(memory);
+	memcpy(V, in, sizeof(V));
+	in += sizeof(V);
+	in = getValue(in, value, 2);
+	I = (unsigned short)value;
+	in = getValue(in, value, 2);
+	pc = (unsigned short)value;
+	delay_timer = *in++;
+	if ((sound_timer != 0) != (*in != 0)) {
+		noteSound(*in != 0, 0);
+	}
+	sound_timer = *in++;
+	for (int i = 0; i < 16; ++i) {
+		in = getValue(in, value, 2);
+		stack[i] = (unsigned short)value;
+	}
+	in += 2;
+	sp = (unsigned short)saved_sp;
+	in = getValue(in, value, 4);
+	rom_size = (unsigned long)value;
+	for (int y = 0; y < 64; ++y) {
+		in = getValue(in, gfx[y][0], 8);
+		in = getValue(in, gfx[y][1], 8);
+	}
+	memcpy(key, in, sizeof(key));
+	in += sizeof(key);
+	in = getValue(in, value, 4);
+	rng = value != 0 ? (uint32_t)value : 1;
+	hires = *in++ != 0;
+	memcpy(rpl, in, sizeof(rpl));
+	dirty_rows = ALL_ROWS;
+	return true;
+}
 
-	fclose(romFile);
-	free(buffer);
+//Write the machine to a save-state file
+bool chip8::saveStateFile(const char* filename) {
+	unsigned char state[STATE_SIZE];
+	saveState(state, STATE_SIZE);
+
+	#pragma warning(suppress : 4996)
+	FILE* stateFile = fopen(filename, "wb");
+	if (stateFile == NULL) {
+		fputs("Could not open save state file", stderr);
+		return false;
+	}
+	bool written = fwrite(state, 1, STATE_SIZE, stateFile) == STATE_SIZE;
+	if (fclose(stateFile) != 0 || !written) {
+		fputs("Error writing save state file", stderr);
+		return false;
+	}
 	return true;
 }
 
-//Emulate one CPU cycle
-bool chip8::emulateCycle() {
-	bool success = true;
-	opcode = memory[pc] << 8 | memory[pc + 1];
-
-	//printf("\n0x%03X    %04X    ", pc, opcode);
-	//Execute opcode
-	switch (opcode & 0xF000) {
-	case 0x0000:
-		switch (opcode & 0x00FF) {
-		case 0x00E0: //00E0: Clears the screen
-			for (int i = 0; i < 2048; ++i) {
-				gfx[i] = 0;
-			}
-			draw_flag = true;
-			pc += 2;
-			break;
+//Restore the machine from a save-state file
+bool chip8::loadStateFile(const char* filename) {
+	unsigned char state[STATE_SIZE];
 
-		case 0x00EE: //00EE: Returns from a subroutine
-			--sp;
-			pc = stack[sp];
-			stack[sp] = 0;
-			pc += 2;
-			break;
+	#pragma warning(suppress : 4996)
+	FILE* stateFile = fopen(filename, "rb");
+	if (stateFile == NULL) {
+		fputs("Could not open save state file", stderr);
+		return false;
+	}
+	unsigned long result = (unsigned long)fread(state, 1, STATE_SIZE, stateFile);
+	fclose(stateFile);
+	if (!loadState(state, result)) {
+		fputs("Not a valid save state", stderr);
+		return false;
+	}
+	return true;
+}
 
-		default: //0NNN: Unnecessary
-			printf("\n\nPC: %04X\nOP: %04X", pc, opcode);
-			success = false;
-			break;
-		} break;
+//Make into an exact copy of this machine, keys included. The state is one block copy, and memory is compared
+//in blocks first so into only redecodes and retranslates code where the two machines' memory differed. That relies
+//on into's decoded matching its memory, which holds from construction on.
+void chip8::clone(chip8& into) const {
+	if (&into == this) {
+		return;
+	}
+	uint64_t changed = 0; //Bit n set if memory block n differs, 64 blocks of 64 bytes
+	for (unsigned int block = 0; block < 64; ++block) {
+		if (memcmp(memory + block * 64, into.memory + block * 64, 64) != 0) {
+			changed |= (uint64_t)1 << block;
+		}
+	}
+	if ((into.sound_timer != 0) != (sound_timer != 0)) {
+		into.noteSound(sound_timer != 0, 0);
+	}
+	static_cast<chip8_state&>(into) = *this;
+	memcpy(into.key, key, sizeof(key));
+	if (into.quirks != quirks) {
+		into.setQuirks(quirks);
+	}
+	into.dirty_rows = ALL_ROWS;
+	for (unsigned int block = 0; block < 64; ++block) {
+		if (changed & ((uint64_t)1 << block)) {
+			into.invalidate((unsigned short)(block * 64), 64);
+		}
+	}
+}
 
-	case 0x1000: //1NNN: Jumps to address NNN
-		pc = opcode & 0x0FFF;
-		break;
-		
-	case 0x2000: //2NNN: Calls subroutine at NNN
-		stack[sp] = pc;
-		++sp;
-		pc = opcode & 0x0FFF;
-		break;
+//Add a sound event offset cycles after cycles_total. Events alternate, so when the list is full dropping the
+//last one and not adding this one leaves the buzzer in the same state.
+void chip8::noteSound(bool on, unsigned long offset) {
+	if (sound_event_count == MAX_SOUND_EVENTS) {
+		--sound_event_count;
+		return;
+	}
+	chip8_sound_event& event = sound_events[sound_event_count++];
+	event.cycle = cycles_total + offset;
+	event.on = on;
+}
+
+//Forget decoded opcodes overlapping written memory
+void chip8::invalidate(unsigned short address, unsigned short length) {
+	//The opcode starting one byte before the write also contains a written byte
+	for (unsigned short i = 0; i <= length; ++i) {
+		decoded[(address + i - 1) & 0xFFF].handler = OP_DECODE;
+	}
+	if (jit != NULL) {
+		jit->invalidate(address, length);
+	}
+}
 
-	case 0x3000: //3XNN: Skips next instruction if VX == NN
-		if (V[(opcode & 0x0F00) >> 8] == (opcode & 0x00FF)) {
-			pc += 4;
+//XOR an 8 or 16 pixel wide sprite onto the low resolution display and mark the rows it changed, returns nonzero if a lit pixel was cleared.
+//Each sprite row is shifted into place and XORed onto a whole display row, and what runs off the right edge wraps to the left.
+uint64_t chip8::drawLores(unsigned short address, unsigned int x, unsigned int y, unsigned int height, unsigned int width, bool wrap) {
+	x &= 63;
+	y &= 31;
+	uint64_t collision = 0;
+	for (unsigned int yline = 0; yline < height; ++yline) {
+		if (y + yline >= 32 && !wrap) {
+			break;
+		}
+		uint64_t sprite;
+		if (width == 16) {
+			sprite = (uint64_t)memory[(address + yline * 2) & 0xFFF] << 56 | (uint64_t)memory[(address + yline * 2 + 1) & 0xFFF] << 48;
 		} else {
-			pc += 2;
+			sprite = (uint64_t)memory[(address + yline) & 0xFFF] << 56;
 		}
-		break;
+		uint64_t line = sprite >> x;
+		if (x > 64 - width && wrap) {
+			line |= sprite << (64 - x);
+		}
+		uint64_t& row = gfx[(y + yline) & 31][0];
+		collision |= row & line;
+		row ^= line;
+		dirty_rows |= (uint64_t)(line != 0) << ((y + yline) & 31);
+	}
+	return collision;
+}
 
-	case 0x4000: //4XNN: Skips next instruction if VX != NN
-		if (V[(opcode & 0x0F00) >> 8] != (opcode & 0x00FF)) {
-			pc += 4;
+//XOR an 8 or 16 pixel wide sprite onto the high resolution display and mark the rows it changed, returns nonzero if a lit pixel was cleared.
+//Each sprite row is shifted across the two words of a display row, and what runs off the right edge wraps to the left.
+uint64_t chip8::drawHires(unsigned short address, unsigned int x, unsigned int y, unsigned int height, unsigned int width, bool wrap) {
+	x &= 127;
+	y &= 63;
+	uint64_t collision = 0;
+	for (unsigned int yline = 0; yline < height; ++yline) {
+		if (y + yline >= 64 && !wrap) {
+			break;
+		}
+		uint64_t sprite;
+		if (width == 16) {
+			sprite = (uint64_t)memory[(address + yline * 2) & 0xFFF] << 56 | (uint64_t)memory[(address + yline * 2 + 1) & 0xFFF] << 48;
+		} else {
+			sprite = (uint64_t)memory[(address + yline) & 0xFFF] << 56;
+		}
+		uint64_t left = 0, right = 0;
+		if (x < 64) {
+			left = sprite >> x;
+			right = x > 0 ? sprite << (64 - x) : 0;
 		} else {
-			pc += 2;
+			right = sprite >> (x - 64);
 		}
-		break;
+		if (x > 128 - width && wrap) {
+			left |= sprite << (128 - x);
+		}
+		uint64_t* row = gfx[(y + yline) & 63];
+		collision |= (row[0] & left) | (row[1] & right);
+		row[0] ^= left;
+		row[1] ^= right;
+		dirty_rows |= (uint64_t)((left | right) != 0) << ((y + yline) & 63);
+	}
+	return collision;
+}
 
-	case 0x5000: //5XY0: Skips next instruction if VX == VY
-		if (V[(opcode & 0x0F00) >> 8] == V[(opcode & 0x00F0) >> 4]) {
-			pc += 4;
+//Move the display down or sideways, clearing what scrolls in, and mark the rows that changed. Rows move as whole
+//words and sideways scrolls are a shift across the two words of each row, in pixels of the current resolution. In low
+//resolution that's Octo's distances, twice what SCHIP 1.1 scrolls since it moved high resolution pixels.
+void chip8::scrollDisplay(int down, int right) {
+	int height = getHeight();
+	if (down > 0) {
+		for (int y = height - 1; y >= 0; --y) {
+			uint64_t first = y >= down ? gfx[y - down][0] : 0;
+			uint64_t second = y >= down ? gfx[y - down][1] : 0;
+			dirty_rows |= (uint64_t)(((gfx[y][0] ^ first) | (gfx[y][1] ^ second)) != 0) << y;
+			gfx[y][0] = first;
+			gfx[y][1] = second;
+		}
+	}
+	for (int y = 0; y < height && right != 0; ++y) {
+		uint64_t* row = gfx[y];
+		dirty_rows |= (uint64_t)((row[0] | row[1]) != 0) << y; //Any lit pixel moves
+		if (!hires) {
+			row[0] = right > 0 ? row[0] >> right : row[0] << -right;
+		} else if (right > 0) {
+			row[1] = (row[1] >> right) | (row[0] << (64 - right));
+			row[0] >>= right;
 		} else {
-			pc += 2;
+			row[0] = (row[0] << -right) | (row[1] >> (64 + right));
+			row[1] <<= -right;
 		}
-		break;
+	}
+}
+
+//Which idle loop the jump at pc closes, judged from memory alone. Keys only change and the timers only tick between
+//runs, so once one of these loops is entered the rest of the run is spent in it.
+chip8::idle_loop chip8::idleLoop(unsigned short pc) const {
+	pc &= 0xFFF;
+	chip8_instruction jump = decodeOpcode(memory[pc] << 8 | memory[(pc + 1) & 0xFFF]);
+	if (jump.handler != OP_1NNN) {
+		return IDLE_NONE;
+	}
+	if (jump.nnn == pc) {
+		return IDLE_JUMP;
+	}
+	if (jump.nnn + 4 != pc) {
+		return IDLE_NONE;
+	}
+	chip8_instruction read = decodeOpcode(memory[jump.nnn] << 8 | memory[jump.nnn + 1]);
+	chip8_instruction test = decodeOpcode(memory[jump.nnn + 2] << 8 | memory[jump.nnn + 3]);
+	if (read.handler == OP_FX07 && (test.handler == OP_3XNN || test.handler == OP_4XNN) && test.x == read.x) {
+		return IDLE_POLL;
+	}
+	return IDLE_NONE;
+}
+
+//Fast-forward cycles through the idle loop closed by the jump at pc, leaving pc, VX and opcode exactly where running
+//them would. False if pc doesn't close an idle loop, or it's a poll whose skip the delay timer lets it take now.
+bool chip8::skipIdle(unsigned short& pc, unsigned long cycles) {
+	idle_loop loop = idleLoop(pc);
+	if (loop == IDLE_JUMP) {
+		opcode = memory[pc & 0xFFF] << 8 | memory[(pc + 1) & 0xFFF];
+		return true;
+	}
+	if (loop != IDLE_POLL) {
+		return false;
+	}
+	unsigned short start = pc - 4;
+	chip8_instruction read = decodeOpcode(memory[start] << 8 | memory[start + 1]);
+	chip8_instruction test = decodeOpcode(memory[start + 2] << 8 | memory[start + 3]);
+	bool skips = (delay_timer == test.nn) == (test.handler == OP_3XNN);
+	if (skips) {
+		return false;
+	}
 
-	case 0x6000: //6XNN: Sets VX to NN
-		V[(opcode & 0x0F00) >> 8] = (opcode & 0x00FF);
-		pc += 2;
-		break;
+	//The loop is jump, FX07, skip test, three cycles a time starting from the jump
+	if (cycles >= 2) {
+		V[read.x] = delay_timer;
+	}
+	static const unsigned short offsets[3] = { 4, 0, 2 };
+	static const unsigned short last[3] = { 2, 4, 0 }; //Offset of the instruction run last
+	unsigned short at = start + last[cycles % 3];
+	opcode = memory[at] << 8 | memory[at + 1];
+	pc = start + offsets[cycles % 3];
+	return true;
+}
 
-	case 0x7000: //7XNN: Adds NN to VX (Carry flag not changed)
-		V[(opcode & 0x0F00) >> 8] += (opcode & 0x00FF);
-		pc += 2;
-		break;
+//Emulate one CPU cycle
+bool chip8::emulateCycle() {
+	return interpret(1) != RUN_INVALID_OPCODE;
+}
 
-	case 0x8000:
-		switch (opcode & 0x000F) {
-		case 0x0000: //8XY0: Sets VX to the value of VY
-			V[(opcode & 0x0F00) >> 8] = V[(opcode & 0x00F0) >> 4];
-			pc += 2;
-			break;
+//Run cycles through the decoded handlers, profiled if a profile is attached. Only the quirk profile and whether to
+//profile are chosen at runtime, each interpreter instance has its quirks and profiling compiled in.
+chip8::run_result chip8::interpret(unsigned long cycles) {
+	switch (quirks) {
+	case QUIRKS_VIP: return interpretQuirks<QUIRKS_VIP>(cycles);
+	case QUIRKS_SCHIP: return interpretQuirks<QUIRKS_SCHIP>(cycles);
+	case QUIRKS_XOCHIP: return interpretQuirks<QUIRKS_XOCHIP>(cycles);
+	default: return interpretQuirks<QUIRKS_OCTOCHIP>(cycles);
+	}
+}
 
-		case 0x0001: //8XY1: Sets VX to VX OR VY
-			V[(opcode & 0x0F00) >> 8] |= V[(opcode & 0x00F0) >> 4];
-			pc += 2;
-			break;
+//Run cycles through the instance compiled for Quirks, profiled if a profile is attached
+template <unsigned Quirks>
+chip8::run_result chip8::interpretQuirks(unsigned long cycles) {
+	if (profile != NULL) {
+		return execute<chip8_profile, Quirks>(cycles, *profile);
+	}
+	chip8_no_profile none;
+	return execute<chip8_no_profile, Quirks>(cycles, none);
+}
 
-		case 0x0002: //8XY2: Sets VX to VX AND VY
-			V[(opcode & 0x0F00) >> 8] &= V[(opcode & 0x00F0) >> 4];
-			pc += 2;
-			break;
+//Count every instruction run into profile, NULL to stop. The JIT is bypassed while profiling.
+void chip8::setProfile(chip8_profile* profile) {
+	this->profile = profile;
+}
 
-		case 0x0003: //8XY3: Sets VX to VX XOR VY
-			V[(opcode & 0x0F00) >> 8] ^= V[(opcode & 0x00F0) >> 4];
-			pc += 2;
-			break;
+//Quirk profiles by name
+static const struct {
+	const char* name;
+	chip8::quirk_profile quirks;
+} QUIRK_PROFILES[] = {
+	{ "octochip", chip8::QUIRKS_OCTOCHIP },
+	{ "vip", chip8::QUIRKS_VIP },
+	{ "schip", chip8::QUIRKS_SCHIP },
+	{ "xochip", chip8::QUIRKS_XOCHIP }
+};
 
-		case 0x0004: //8XY4: Adds VY to VX (Set VF to 1 when there is a carry)
-			if (V[(opcode & 0x00F0) >> 4] > (0xFF - V[(opcode & 0x0F00) >> 8])) {
-				V[0xF] = 1;
-			} else {
-				V[0xF] = 0;
-			}
-			V[(opcode & 0x0F00) >> 8] += V[(opcode & 0x00F0) >> 4];
-			pc += 2;
-			break;
+//Pick the interpreter instance compiled for quirks, loading a ROM keeps it. Translations are dropped, the JIT
+//leaves opcodes the quirks change to the interpreter.
+void chip8::setQuirks(quirk_profile quirks) {
+	this->quirks = quirks;
+	if (jit != NULL) {
+		jit->flush();
+	}
+}
 
-		case 0x0005: //8XY5: Sets VX to VX - VY (Set VF to 1 when there is no borrow)
-			if (V[(opcode & 0x00F0) >> 4] > (V[(opcode & 0x0F00) >> 8])) {
-				V[0xF] = 0;
-			} else {
-				V[0xF] = 1;
-			}
-			V[(opcode & 0x0F00) >> 8] -= V[(opcode & 0x00F0) >> 4];
-			pc += 2;
-			break;
+//Look up a quirk profile by name, false if there's none with that name
+bool chip8::findQuirks(const char* name, quirk_profile& quirks) {
+	for (size_t i = 0; i < sizeof(QUIRK_PROFILES) / sizeof(QUIRK_PROFILES[0]); ++i) {
+		if (strcmp(name, QUIRK_PROFILES[i].name) == 0) {
+			quirks = QUIRK_PROFILES[i].quirks;
+			return true;
+		}
+	}
+	return false;
+}
 
-		case 0x0006: //8XY6: Stores the least significant bit of VX in VF then shifts VX right by 1
-			V[0xF] = V[(opcode & 0x0F00) >> 8] & 0x01;
-			V[(opcode & 0x0F00) >> 8] >>= 1;
-			pc += 2;
-			break;
+//Name of a quirk profile
+const char* chip8::quirksName(quirk_profile quirks) {
+	for (size_t i = 0; i < sizeof(QUIRK_PROFILES) / sizeof(QUIRK_PROFILES[0]); ++i) {
+		if (QUIRK_PROFILES[i].quirks == quirks) {
+			return QUIRK_PROFILES[i].name;
+		}
+	}
+	return "unknown";
+}
 
-		case 0x0007: //8XY7: Sets VX to VY - VX (Set VF to 1 when there is no borrow)
-			if (V[(opcode & 0x0F00) >> 8] > (V[(opcode & 0x00F0) >> 4])) {
-				V[0xF] = 0;
-			} else {
-				V[0xF] = 1;
+//Emulate up to cycles CPU cycles, stopping early after a draw, on an unknown opcode or while waiting for a key
+chip8::run_result chip8::runCycles(unsigned long cycles) {
+	unsigned long total = 0;
+	unsigned long skipped = 0;
+	run_result result = RUN_DONE;
+	while (total < cycles) {
+		if (jit != NULL && profile == NULL) {
+			//Translated blocks never draw, wait or fail, so only the interpreted opcode after them can stop the run.
+			//The JIT leaves the jumps closing idle loops to be skipped here.
+			unsigned long ran = jit->run(*this, cycles - total);
+			total += ran;
+			cycles_total += ran;
+			if (total == cycles) {
+				break;
 			}
-			V[(opcode & 0x0F00) >> 8] = V[(opcode & 0x00F0) >> 4] - V[(opcode & 0x0F00) >> 8];
-			pc += 2;
+			if (skipIdle(pc, cycles - total)) {
+				skipped += cycles - total;
+				cycles_total += cycles - total;
+				total = cycles;
+				break;
+			}
+			result = interpret(1);
+		} else {
+			result = interpret(cycles - total);
+		}
+		total += cycles_run;
+		skipped += cycles_skipped;
+		if (result != RUN_DONE) {
 			break;
+		}
+	}
+	cycles_run = total;
+	cycles_skipped = skipped;
+	return result;
+}
 
-		case 0x000E: //8XYE: Stores the most significant bit of VX in VF then shifts VX to the left by 1
-			V[0xF] = V[(opcode & 0x0F00) >> 8] >> 7;
-			V[(opcode & 0x0F00) >> 8] <<= 1;
-			pc += 2;
+//Emulate one 60hz frame and tick the timers once. Draws don't end the frame, an unknown opcode or a key wait does.
+chip8::run_result chip8::runFrame(unsigned long cyclesPerFrame) {
+	unsigned long total = 0;
+	unsigned long skipped = 0;
+	bool drawn = false;
+	run_result result = RUN_DONE;
+	while (total < cyclesPerFrame) {
+		result = runCycles(cyclesPerFrame - total);
+		total += cycles_run;
+		skipped += cycles_skipped;
+		if (result != RUN_DRAWN) {
 			break;
+		}
+		drawn = true;
+		result = RUN_DONE;
+	}
+	if (result != RUN_INVALID_OPCODE) {
+		updateTimers();
+	}
+	cycles_run = total;
+	cycles_skipped = skipped;
+	if (result == RUN_DONE && drawn) {
+		result = RUN_DRAWN;
+	}
+	return result;
+}
 
-		default:
-			printf("\nPC: %04X\nOP: %04X", pc, opcode);
-			success = false;
-			break;
-		} break;
+//Turn the x86-64 JIT on or off, returns false if the host can't run it
+bool chip8::enableJit(bool enable) {
+	if (!enable) {
+		delete jit;
+		jit = NULL;
+		return true;
+	}
+	if (jit == NULL) {
+		jit = new chip8_jit(*this);
+		if (!jit->available()) {
+			delete jit;
+			jit = NULL;
+			return false;
+		}
+	}
+	return true;
+}
 
-	case 0x9000: //9XY0: Skips next instruction if VX != VY
-		if (V[(opcode & 0x0F00) >> 8] != V[(opcode & 0x00F0) >> 4]) {
-			pc += 4;
-		} else {
-			pc += 2;
-		}
-		break;
-
-	case 0xA000: //ANNN: Sets I to address NNN
-		I = opcode & 0x0FFF;
-		pc += 2;
-		break;
-
-	case 0xB000: //BNNN: Jumps to address NNN + V0
-		pc = (opcode & 0x0FFF) + V[0x0];
-		break;
-
-	case 0xC000: //CXNN: Sets VX to the result of bitwise AND on a random number (0-255) and NN
-		V[(opcode & 0x0F00) >> 8] = (rand() % 255) & (opcode & 0x00FF);
-		pc += 2;
-		break;
-
-	case 0xD000: { //DXYN: Draws sprite at coordinate (VX, VY) with width of 8 and height of N+1 pixels
-		unsigned short x = V[(opcode & 0x0F00) >> 8];
-		unsigned short y = V[(opcode & 0x00F0) >> 4];
-		unsigned short height = opcode & 0x000F;
-		unsigned short pixel;
-		V[0xF] = 0;
-
-		for (int yline = 0; yline < height; ++yline) {
-			pixel = memory[I + yline];
-			for (int xline = 0; xline < 8; ++xline) {
-				if ((pixel & (0x80 >> xline)) != 0) {
-					if (gfx[x + xline + ((y + yline) * 64)] == 1) {
-						V[0xF] = 1;
-					}
-					gfx[x + xline + ((y + yline) * 64)] ^= 1;
-				}
-			}
+//Count both timers down once, call at 60hz
+void chip8::updateTimers() {
+	if (delay_timer > 0) {
+		--delay_timer;
+	}
+	if (sound_timer > 0) {
+		if (--sound_timer == 0) {
+			noteSound(false, 0);
 		}
+	}
+}
 
-		draw_flag = true;
-		pc += 2;
-		} break;
-		
-	case 0xE000:
-		switch (opcode & 0x00FF) {
-		case 0x009E: //EX9E: Skips next instruction if the key stored in VX is pressed
-			if (key[V[(opcode & 0x0F00) >> 8]] == 1) {
-				pc += 4;
-			} else {
-				pc += 2;
-			}
-			break;
+//Every handler ends by moving pc and jumping straight to the next handler, draws end the run after moving pc.
+//GCC and Clang thread the handlers with computed gotos, other compilers go back through the switch.
+//Every handler reports the instruction to the profile policy first, which is empty unless profiling.
+//Quirks is a constant in each instance, so the quirk tests below are folded away and no handler branches on them.
+#if defined(__GNUC__)
+#define LABEL(name) case name: L_##name:
+#define DISPATCH() goto *handlers[op->handler]
+#else
+#define LABEL(name) case name:
+#define DISPATCH() goto dispatch
+#endif
+#define HANDLER(name) LABEL(name) profile.instruction(pc, *op);
+#define NEXT(advance) pc += (advance); if (--cycles == 0) goto done; op = &decoded[pc & 0xFFF]; DISPATCH()
+#define DRAWN() pc += 2; --cycles; result = RUN_DRAWN; goto done
 
-		case 0x00A1: //EXA1: Skips next instruction if the key stored in VX is not pressed
-			if (key[V[(opcode & 0x0F00) >> 8]] == 0) {
-				pc += 4;
-			} else {
-				pc += 2;
-			}
-			break;
+//Run cycles through the decoded handlers, cycles_run is set to the cycles completed
+template <class Profile, unsigned Quirks>
+chip8::run_result chip8::execute(unsigned long cycles, Profile& profile) {
+	const bool wrap = (Quirks & QUIRK_CLIP) == 0;
+	#if defined(__GNUC__)
+	static void* const handlers[OP_COUNT] = {
+		&&L_OP_DECODE,
+		&&L_OP_INVALID,
+		&&L_OP_00CN, &&L_OP_00E0, &&L_OP_00EE, &&L_OP_00FB, &&L_OP_00FC, &&L_OP_00FE, &&L_OP_00FF, &&L_OP_1NNN, &&L_OP_2NNN, &&L_OP_3XNN, &&L_OP_4XNN, &&L_OP_5XY0, &&L_OP_6XNN, &&L_OP_7XNN,
+		&&L_OP_8XY0, &&L_OP_8XY1, &&L_OP_8XY2, &&L_OP_8XY3, &&L_OP_8XY4, &&L_OP_8XY5, &&L_OP_8XY6, &&L_OP_8XY7, &&L_OP_8XYE,
+		&&L_OP_9XY0, &&L_OP_ANNN, &&L_OP_BNNN, &&L_OP_CXNN, &&L_OP_DXYN, &&L_OP_DXY0, &&L_OP_EX9E, &&L_OP_EXA1,
+		&&L_OP_FX07, &&L_OP_FX0A, &&L_OP_FX15, &&L_OP_FX18, &&L_OP_FX1E, &&L_OP_FX29, &&L_OP_FX30, &&L_OP_FX33, &&L_OP_FX55, &&L_OP_FX65, &&L_OP_FX75, &&L_OP_FX85
+	};
+	#endif
+	run_result result = RUN_DONE;
+	const unsigned long requested = cycles;
+	cycles_skipped = 0;
+	if (cycles == 0) {
+		cycles_run = 0;
+		return result;
+	}
 
-		default:
-			printf("\n\nPC: %04X\nOP: %04X", pc, opcode);
-			success = false;
-			break;
-		} break;
+	//Keep the hot registers in locals so they stay in host registers across the run
+	unsigned short pc = this->pc;
+	unsigned short I = this->I;
+	const chip8_instruction* op = &decoded[pc & 0xFFF];
 
-	case 0xF000:
-		switch (opcode & 0x00FF) {
-		case 0x0007: //FX07: Sets VX to the value of the delay timer
-			V[(opcode & 0x0F00) >> 8] = delay_timer;
-			pc += 2;
-			break;
+	#if !defined(__GNUC__)
+	dispatch:
+	#endif
+	switch (op->handler) {
+	LABEL(OP_DECODE) //Decode on first execution, then run the decoded opcode
+		decoded[pc & 0xFFF] = decodeOpcode(memory[pc & 0xFFF] << 8 | memory[(pc + 1) & 0xFFF]);
+		DISPATCH();
 
-		case 0x000A: //FX0A: A key press is awaited, then stored in VX
-			for (int i = 0; i <= 0xF; ++i) {
-				if (key[i] == 1) {
-					pc += 2;
-				}
-			} break;
+	HANDLER(OP_00CN) //00CN: Scrolls the screen down N lines (SCHIP)
+		scrollDisplay(op->nn & 0xF, 0);
+		DRAWN();
 
-		case 0x0015: //FX15: Sets the delay timer to VX
-			delay_timer = V[(opcode & 0x0F00) >> 8];
-			pc += 2;
-			break;
+	HANDLER(OP_00E0) { //00E0: Clears the screen
+		uint64_t started = profile.start();
+		for (int y = 0; y < 64; ++y) {
+			dirty_rows |= (uint64_t)((gfx[y][0] | gfx[y][1]) != 0) << y; //Only rows with something lit change
+		}
+		memset(gfx, 0, sizeof(gfx));
+		profile.stop(OP_00E0, started);
+		DRAWN();
+	}
 
-		case 0x0018: //FX18: Sets the sound timer to VX
-			sound_timer = V[(opcode & 0x0F00) >> 8];
-			pc += 2;
-			break;
+	HANDLER(OP_00EE) //00EE: Returns from a subroutine
+		if (sp == 0) {
+			goto invalid;
+		}
+		--sp;
+		pc = stack[sp];
+		stack[sp] = 0;
+		NEXT(2);
 
-		case 0x001E: //FX1E: Adds VX to I (VF not affected)
-			I += V[(opcode & 0x0F00) >> 8];
-			pc += 2;
-			break;
+	HANDLER(OP_00FB) //00FB: Scrolls the screen right 4 pixels (SCHIP)
+		scrollDisplay(0, 4);
+		DRAWN();
 
-		case 0x0029: //FX29: Sets I to the location of the sprite for the character VX from the fontset
-			I = V[(opcode & 0x0F00) >> 8] * 5;
-			pc += 2;
-			break;
+	HANDLER(OP_00FC) //00FC: Scrolls the screen left 4 pixels (SCHIP)
+		scrollDisplay(0, -4);
+		DRAWN();
 
-		case 0x0033: //FX33: Stores binary-coded decimal of VX at I
-			memory[I] = V[(opcode & 0x0F00) >> 8] / 100;
-			memory[I + 1] = (V[(opcode & 0x0F00) >> 8] / 10) % 10;
-			memory[I + 2] = (V[(opcode & 0x0F00) >> 8] % 100) % 10;
-			pc += 2;
-			break;
+	HANDLER(OP_00FE) //00FE: Switches to the 64x32 low resolution screen and clears it (SCHIP)
+		hires = false;
+		memset(gfx, 0, sizeof(gfx));
+		dirty_rows = ALL_ROWS;
+		DRAWN();
 
-		case 0x0055: //FX55: Stores V0 to VX (Including VX) in memory starting from address I
-			for (int i = 0; i <= ((opcode & 0x0F00) >> 8); ++i) {
-				memory[I + i] = V[i];
-				//???? INCREMENTING MAY BE NECESSARY ????
-			}
-			pc += 2;
-			break;
+	HANDLER(OP_00FF) //00FF: Switches to the 128x64 high resolution screen and clears it (SCHIP)
+		hires = true;
+		memset(gfx, 0, sizeof(gfx));
+		dirty_rows = ALL_ROWS;
+		DRAWN();
 
-		case 0x0065: //FX65: Fills V0 to VX (Including VX) with values from memory starting from I
-			for (int i = 0; i <= ((opcode & 0x0F00) >> 8); ++i) {
-				V[i] = memory[I + i];
-			}
-			//???? INCREMENTING MAY BE NECESSARY ????
-			pc += 2;
-			break;
+	HANDLER(OP_1NNN) //1NNN: Jumps to address NNN
+		profile.jump(pc, op->nnn);
+		if (Profile::FAST_FORWARD && (op->nnn == pc || op->nnn + 4 == pc) && skipIdle(pc, cycles)) {
+			cycles_skipped = cycles; //Nothing can leave the loop before the run ends, so the rest of it is skipped
+			cycles = 0;
+			goto skipped;
+		}
+		pc = op->nnn;
+		NEXT(0);
 
-		default:
-			printf("\n\nPC: %04X\nOP: %04X", pc, opcode);
-			success = false;
-			break;
-		} break;
+	HANDLER(OP_2NNN) //2NNN: Calls subroutine at NNN
+		if (sp == 16) {
+			goto invalid;
+		}
+		stack[sp] = pc;
+		++sp;
+		pc = op->nnn;
+		NEXT(0);
 
-	default:
-		printf("\n\nPC: %04X\nOP: %04X", pc, opcode);
-		success = false;
-		break;
+	HANDLER(OP_3XNN) //3XNN: Skips next instruction if VX == NN
+		NEXT(V[op->x] == op->nn ? 4 : 2);
+
+	HANDLER(OP_4XNN) //4XNN: Skips next instruction if VX != NN
+		NEXT(V[op->x] != op->nn ? 4 : 2);
+
+	HANDLER(OP_5XY0) //5XY0: Skips next instruction if VX == VY
+		NEXT(V[op->x] == V[op->y] ? 4 : 2);
+
+	HANDLER(OP_6XNN) //6XNN: Sets VX to NN
+		V[op->x] = op->nn;
+		NEXT(2);
+
+	HANDLER(OP_7XNN) //7XNN: Adds NN to VX (Carry flag not changed)
+		V[op->x] += op->nn;
+		NEXT(2);
+
+	HANDLER(OP_8XY0) //8XY0: Sets VX to the value of VY
+		V[op->x] = V[op->y];
+		NEXT(2);
+
+	HANDLER(OP_8XY1) //8XY1: Sets VX to VX OR VY
+		V[op->x] |= V[op->y];
+		if (Quirks & QUIRK_VF_RESET) {
+			V[0xF] = 0;
+		}
+		NEXT(2);
+
+	HANDLER(OP_8XY2) //8XY2: Sets VX to VX AND VY
+		V[op->x] &= V[op->y];
+		if (Quirks & QUIRK_VF_RESET) {
+			V[0xF] = 0;
+		}
+		NEXT(2);
+
+	HANDLER(OP_8XY3) //8XY3: Sets VX to VX XOR VY
+		V[op->x] ^= V[op->y];
+		if (Quirks & QUIRK_VF_RESET) {
+			V[0xF] = 0;
+		}
+		NEXT(2);
+
+	HANDLER(OP_8XY4) { //8XY4: Adds VY to VX (Set VF to 1 when there is a carry)
+		unsigned char carry = V[op->y] > (0xFF - V[op->x]);
+		V[0xF] = carry;
+		V[op->x] += V[op->y];
+		NEXT(2);
 	}
 
-	//Update timers
-	if (delay_timer > 0) {
-		--delay_timer;
+	HANDLER(OP_8XY5) { //8XY5: Sets VX to VX - VY (Set VF to 1 when there is no borrow)
+		unsigned char no_borrow = V[op->y] <= V[op->x];
+		V[0xF] = no_borrow;
+		V[op->x] -= V[op->y];
+		NEXT(2);
 	}
-	if (sound_timer > 0) {
-		if (sound_timer == 1) {
-			printf("BEEP!\n\a"); //Yes, I'm this lazy
+
+	HANDLER(OP_8XY6) //8XY6: Stores the least significant bit of VX in VF then shifts VX right by 1
+		if (Quirks & QUIRK_SHIFT_VY) {
+			V[op->x] = V[op->y];
+		}
+		V[0xF] = V[op->x] & 0x01;
+		V[op->x] >>= 1;
+		NEXT(2);
+
+	HANDLER(OP_8XY7) { //8XY7: Sets VX to VY - VX (Set VF to 1 when there is no borrow)
+		unsigned char no_borrow = V[op->x] <= V[op->y];
+		V[0xF] = no_borrow;
+		V[op->x] = V[op->y] - V[op->x];
+		NEXT(2);
+	}
+
+	HANDLER(OP_8XYE) //8XYE: Stores the most significant bit of VX in VF then shifts VX to the left by 1
+		if (Quirks & QUIRK_SHIFT_VY) {
+			V[op->x] = V[op->y];
+		}
+		V[0xF] = V[op->x] >> 7;
+		V[op->x] <<= 1;
+		NEXT(2);
+
+	HANDLER(OP_9XY0) //9XY0: Skips next instruction if VX != VY
+		NEXT(V[op->x] != V[op->y] ? 4 : 2);
+
+	HANDLER(OP_ANNN) //ANNN: Sets I to address NNN
+		I = op->nnn;
+		NEXT(2);
+
+	HANDLER(OP_BNNN) { //BNNN: Jumps to address NNN + V0, or XNN + VX with QUIRK_JUMP_VX
+		unsigned short target = op->nnn + V[(Quirks & QUIRK_JUMP_VX) ? op->x : 0];
+		profile.jump(pc, target);
+		pc = target;
+		NEXT(0);
+	}
+
+	HANDLER(OP_CXNN) //CXNN: Sets VX to the result of bitwise AND on a random number (0-255) and NN
+		rng ^= rng << 13; //Xorshift, the same numbers chip8_lanes draws from the same seed
+		rng ^= rng >> 17;
+		rng ^= rng << 5;
+		V[op->x] = (rng % 255) & op->nn;
+		NEXT(2);
+
+	HANDLER(OP_DXYN) { //DXYN: Draws sprite at coordinate (VX, VY) with width of 8 and height of N pixels
+		unsigned int height = op->nn & 0x000F;
+		uint64_t collision = 0;
+		uint64_t started = profile.start();
+
+		if (hires) {
+			collision = drawHires(I, V[op->x], V[op->y], height, 8, wrap);
+		} else {
+			collision = drawLores(I, V[op->x], V[op->y], height, 8, wrap);
+		}
+		V[0xF] = collision != 0;
+
+		profile.stop(OP_DXYN, started);
+		DRAWN();
+	}
+
+	HANDLER(OP_DXY0) { //DXY0: Draws a 16x16 sprite at coordinate (VX, VY) in high resolution (SCHIP). In low resolution it draws an 8x16 sprite with QUIRK_LORES_TALL, a 16x16 one with QUIRK_LORES_WIDE and nothing otherwise.
+		uint64_t collision = 0;
+		uint64_t started = profile.start();
+		if (hires) {
+			collision = drawHires(I, V[op->x], V[op->y], 16, 16, wrap);
+		} else if (Quirks & QUIRK_LORES_WIDE) {
+			collision = drawLores(I, V[op->x], V[op->y], 16, 16, wrap);
+		} else if (Quirks & QUIRK_LORES_TALL) {
+			collision = drawLores(I, V[op->x], V[op->y], 16, 8, wrap);
+		}
+		V[0xF] = collision != 0;
+		profile.stop(OP_DXY0, started);
+		DRAWN();
+	}
+
+	HANDLER(OP_EX9E) //EX9E: Skips next instruction if the key stored in VX is pressed
+		key_read[V[op->x] & 0xF] = 1;
+		NEXT(key[V[op->x] & 0xF] == 1 ? 4 : 2);
+
+	HANDLER(OP_EXA1) //EXA1: Skips next instruction if the key stored in VX is not pressed
+		key_read[V[op->x] & 0xF] = 1;
+		NEXT(key[V[op->x] & 0xF] == 0 ? 4 : 2);
+
+	HANDLER(OP_FX07) //FX07: Sets VX to the value of the delay timer
+		V[op->x] = delay_timer;
+		NEXT(2);
+
+	HANDLER(OP_FX0A) //FX0A: A key press is awaited, then stored in VX
+		for (int i = 0; i <= 0xF; ++i) {
+			if (key[i] == 1) {
+				key_read[i] = 1;
+				V[op->x] = i;
+				NEXT(2);
+			}
+		}
+		result = RUN_WAIT_KEY; //Nothing can change until a key does, so give control back without using the cycle
+		goto done;
+
+	HANDLER(OP_FX15) //FX15: Sets the delay timer to VX
+		delay_timer = V[op->x];
+		NEXT(2);
+
+	HANDLER(OP_FX18) //FX18: Sets the sound timer to VX
+		if ((sound_timer != 0) != (V[op->x] != 0)) {
+			noteSound(V[op->x] != 0, requested - cycles);
+		}
+		sound_timer = V[op->x];
+		NEXT(2);
+
+	HANDLER(OP_FX1E) //FX1E: Adds VX to I (VF not affected)
+		I += V[op->x];
+		NEXT(2);
+
+	HANDLER(OP_FX29) //FX29: Sets I to the location of the sprite for the character VX from the fontset
+		I = V[op->x] * 5;
+		NEXT(2);
+
+	HANDLER(OP_FX30) //FX30: Sets I to the location of the large sprite for the character VX (SCHIP)
+		I = BIGFONT_ADDRESS + (V[op->x] & 0xF) * 10;
+		NEXT(2);
+
+	HANDLER(OP_FX33) //FX33: Stores binary-coded decimal of VX at I
+		hashMemory(I, 3);
+		memory[I & 0xFFF] = V[op->x] / 100;
+		memory[(I + 1) & 0xFFF] = (V[op->x] / 10) % 10;
+		memory[(I + 2) & 0xFFF] = (V[op->x] % 100) % 10;
+		hashMemory(I, 3);
+		invalidate(I, 3);
+		NEXT(2);
+
+	HANDLER(OP_FX55) { //FX55: Stores V0 to VX (Including VX) in memory starting from address I
+		uint64_t started = profile.start();
+		hashMemory(I, op->x + 1);
+		for (int i = 0; i <= op->x; ++i) {
+			memory[(I + i) & 0xFFF] = V[i];
+		}
+		hashMemory(I, op->x + 1);
+		invalidate(I, op->x + 1);
+		if (Quirks & QUIRK_LOAD_STORE_I) {
+			I += op->x + 1;
+		}
+		profile.stop(OP_FX55, started);
+		NEXT(2);
+	}
+
+	HANDLER(OP_FX65) { //FX65: Fills V0 to VX (Including VX) with values from memory starting from I
+		uint64_t started = profile.start();
+		for (int i = 0; i <= op->x; ++i) {
+			V[i] = memory[(I + i) & 0xFFF];
 		}
-		--sound_timer;
+		if (Quirks & QUIRK_LOAD_STORE_I) {
+			I += op->x + 1;
+		}
+		profile.stop(OP_FX65, started);
+		NEXT(2);
 	}
 
-	return success;
-}
\ No newline at end of file
+	HANDLER(OP_FX75) //FX75: Stores V0 to VX (Including VX) in the RPL user flags (SCHIP)
+		memcpy(rpl, V, op->x + 1);
+		NEXT(2);
+
+	HANDLER(OP_FX85) //FX85: Fills V0 to VX (Including VX) from the RPL user flags (SCHIP)
+		memcpy(V, rpl, op->x + 1);
+		NEXT(2);
+
+	HANDLER(OP_INVALID)
+	default:
+		goto invalid;
+	}
+
+	invalid:
+	printf("\n\nPC: %04X\nOP: %04X", pc, op->opcode);
+	result = RUN_INVALID_OPCODE;
+
+	done:
+	opcode = op->opcode;
+	skipped: //skipIdle has set opcode to the last instruction of the loop
+	this->pc = pc;
+	this->I = I;
+	cycles_run = requested - cycles;
+	cycles_total += cycles_run;
+	return result;
+}
+
+#undef DRAWN
+#undef NEXT
+#undef HANDLER
+#undef DISPATCH
+#undef LABEL
\ No newline at end of file
@@ -1,26 +1,140 @@
 #pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "chip8_ops.h"
 
-class chip8 {
-public:
-	bool draw_flag; //True whenever gfx has changed and screen needs to be updated
-	unsigned char gfx[64 * 32]; //Pixels on the screen
-	unsigned char key[16]; //Current state of key inputs
+class chip8_jit;
+class chip8_profile;
 
-	bool emulateCycle(); //Emulate one CPU cycle
-	bool loadApplication(const char* filename); //Load application from file
-	void getRegisters(unsigned short values[]); //Returns the registers and stack
+//The buzzer turning on or off, it sounds while the sound timer is above 0
+struct chip8_sound_event {
+	uint64_t cycle; //Value of cycles_total when it changed
+	bool on; //True when the sound timer was set from 0, false when it reached 0
+};
 
-private:
-	unsigned short opcode; //Current opcode
+//Everything that decides what a machine does next, kept in one cache-line-aligned block so a machine can be cloned with a single copy.
+//new and std::vector only honour the 64-byte alignment from C++17 on, so the core is built as C++17.
+struct alignas(64) chip8_state {
 	unsigned char memory[4096]; //Memory
+	uint64_t gfx[64][2]; //Pixels on the screen, 128 per row in two words with x = 0 in the top bit of the first. Low resolution uses the first word of the first 32 rows.
 	unsigned char V[16]; //CPU registers
+	unsigned short stack[16]; //Stack
+	unsigned short opcode; //Current opcode
 	unsigned short I; //Index register
 	unsigned short pc; //Program counter
+	unsigned short sp; //Stack pointer
 	unsigned char delay_timer; //Both timers count at 60hz
 	unsigned char sound_timer; //Sounds buzzer when 0 is reached
-	unsigned short stack[16]; //Stack
-	unsigned short sp; //Stack pointer
 	unsigned long rom_size; //ROM size
+	uint32_t rng; //Xorshift state for CXNN
+	uint32_t rng_seed; //Seed rng starts from on init
+	unsigned char rpl[16]; //RPL user flags, written by FX75 and read by FX85
+	bool hires; //True in the 128x64 SCHIP resolution, false in the 64x32 one
+	uint64_t memory_hash; //XOR of a hash of every 8-byte word of memory and its index, kept up to date on writes once hashed is set
+	bool hashed; //True while memory_hash matches memory
+};
+
+class chip8 : private chip8_state {
+public:
+	//Why a run returned
+	enum run_result {
+		RUN_DONE, //Ran every cycle asked for
+		RUN_DRAWN, //The screen changed
+		RUN_INVALID_OPCODE, //Hit an unknown opcode, pc is left on it
+		RUN_WAIT_KEY //Waiting on FX0A for a key press
+	};
+
+	//Behaviours CHIP-8 interpreters disagree on
+	enum quirk {
+		QUIRK_SHIFT_VY = 1, //8XY6 and 8XYE shift VY into VX instead of shifting VX
+		QUIRK_LOAD_STORE_I = 2, //FX55 and FX65 leave I after the last register they move
+		QUIRK_JUMP_VX = 4, //BNNN jumps to XNN + VX instead of NNN + V0
+		QUIRK_CLIP = 8, //Sprites are clipped at the screen edges instead of wrapping around
+		QUIRK_VF_RESET = 16, //8XY1, 8XY2 and 8XY3 set VF to 0
+		QUIRK_LORES_TALL = 32, //DXY0 draws an 8x16 sprite in low resolution instead of nothing
+		QUIRK_LORES_WIDE = 64 //DXY0 draws a 16x16 sprite in low resolution instead of nothing
+	};
+
+	//Sets of quirks the interpreter is compiled for, each one runs its own instance of the interpreter
+	enum quirk_profile {
+		QUIRKS_OCTOCHIP = 0, //What this emulator has always done
+		QUIRKS_VIP = QUIRK_SHIFT_VY | QUIRK_LOAD_STORE_I | QUIRK_CLIP | QUIRK_VF_RESET, //The COSMAC VIP interpreter
+		QUIRKS_SCHIP = QUIRK_JUMP_VX | QUIRK_CLIP | QUIRK_LORES_TALL, //SUPER-CHIP 1.1
+		QUIRKS_XOCHIP = QUIRK_SHIFT_VY | QUIRK_LOAD_STORE_I | QUIRK_LORES_WIDE //XO-CHIP and Octo
+	};
+
+	//Bytes written by saveState: header, opcode, memory, V, I, pc, timers, stack, sp, ROM size, display, keys, CXNN state, resolution and RPL flags
+	static const unsigned long STATE_SIZE = 8 + 2 + 4096 + 16 + 2 + 2 + 2 + 32 + 2 + 4 + 1024 + 16 + 4 + 1 + 16;
+	static const int MAX_WIDTH = 128; //Display size in the high resolution, getPixels never writes more than this
+	static const int MAX_HEIGHT = 64;
+	static const int MAX_SOUND_EVENTS = 32; //Sound events kept until the consumer takes them
+
+	chip8(); //Construct without a JIT
+	~chip8(); //Free the JIT
+
+	static const uint64_t ALL_ROWS = ~0ULL; //Every bit of dirty_rows
+
+	uint64_t dirty_rows; //Bit y is set when display row y has changed, the consumer clears the bits it has redrawn. All are set after a resolution change or a load.
+	unsigned char key[16]; //Current state of key inputs
+	unsigned char key_read[16]; //Set to 1 when EX9E, EXA1 or FX0A reads key n, the consumer clears them. Lets frontends tell when input reached the ROM.
+	unsigned long cycles_run; //Cycles completed by the last run
+	unsigned long cycles_skipped; //Cycles of cycles_run that were fast-forwarded through an idle loop instead of run
+	uint64_t cycles_total; //Cycles run since the machine was constructed, skipped ones included, never reset
+	chip8_sound_event sound_events[MAX_SOUND_EVENTS]; //Buzzer changes in the order they happened, on and off alternating
+	int sound_event_count; //Events in sound_events, the consumer sets it back to 0 once it has played them. When full, the last pair is dropped so the newest state is kept.
+
+	bool emulateCycle(); //Emulate one CPU cycle
+	run_result runCycles(unsigned long cycles); //Emulate up to cycles CPU cycles, through translated code when the JIT is enabled
+	run_result runFrame(unsigned long cyclesPerFrame); //Emulate one 60hz frame and tick the timers once
+	void updateTimers(); //Count both timers down once, call at 60hz
+	bool enableJit(bool enable); //Turn the x86-64 JIT on or off, returns false if the host can't run it
+	void setQuirks(quirk_profile quirks); //Pick the interpreter instance compiled for quirks, loading a ROM keeps it
+	quirk_profile getQuirks() const { return quirks; } //Quirk profile the interpreter runs with
+	static bool findQuirks(const char* name, quirk_profile& quirks); //Look up a quirk profile by name, false if there's none with that name
+	static const char* quirksName(quirk_profile quirks); //Name of a quirk profile
+	void setProfile(chip8_profile* profile); //Count every instruction run into profile, NULL to stop. The JIT is bypassed while profiling.
+	bool loadApplication(const char* filename); //Load application from file, false if it can't be read or doesn't fit
+	bool loadFromBuffer(const uint8_t* data, size_t size); //Load application from memory, false if it doesn't fit
+	void seed(uint32_t seed); //Seed the random numbers CXNN draws, loading an application starts again from this seed
+	unsigned long saveState(unsigned char buffer[], unsigned long size); //Write the whole machine into buffer, returns STATE_SIZE or 0 if it doesn't fit
+	bool loadState(const unsigned char buffer[], unsigned long size); //Restore a machine written by saveState, false if buffer isn't a valid state
+	bool saveStateFile(const char* filename); //Write the machine to a save-state file
+	bool loadStateFile(const char* filename); //Restore the machine from a save-state file
+	void clone(chip8& into) const; //Make into an exact copy of this machine, keys and quirks included, redecoding only memory that differed
+	void getRegisters(unsigned short values[]); //Returns the registers and stack
+	int getWidth() const { return hires ? 128 : 64; } //Display width in pixels at the current resolution
+	int getHeight() const { return hires ? 64 : 32; } //Display height in pixels at the current resolution
+	void getPixels(unsigned char pixels[]); //Expand the display to getWidth() * getHeight() bytes, 1 if lit
+	void getPixelsRGBA(uint32_t pixels[], uint32_t on, uint32_t off); //Expand the display to getWidth() * getHeight() colours
+	uint64_t getFrameHash(); //FNV-1a hash of the display
+	uint64_t getStateHash(); //Hash of memory, registers, timers, CXNN state and display, equal for machines that will run identically on the same input
+
+private:
+	chip8_instruction decoded[4096]; //Decoded opcode for every address, filled on first execution. 32 KB of every machine, 8 times its memory.
+	chip8_jit* jit; //Translated blocks, NULL when the JIT is off
+	chip8_profile* profile; //Profile counting every instruction, NULL when not profiling
+	quirk_profile quirks; //Quirk profile the interpreter runs with
 
 	void init(); //Initialize data
+	run_result interpret(unsigned long cycles); //Run cycles through the decoded handlers, profiled if a profile is attached
+	template <unsigned Quirks> run_result interpretQuirks(unsigned long cycles); //Run cycles through the instance compiled for Quirks, profiled if a profile is attached
+	template <class Profile, unsigned Quirks> run_result execute(unsigned long cycles, Profile& profile); //Run cycles through the decoded handlers
+	void invalidate(unsigned short address, unsigned short length); //Forget decoded opcodes overlapping written memory
+	uint64_t drawLores(unsigned short address, unsigned int x, unsigned int y, unsigned int height, unsigned int width, bool wrap); //XOR an 8 or 16 pixel wide sprite onto the low resolution display and mark the rows it changed
+	uint64_t drawHires(unsigned short address, unsigned int x, unsigned int y, unsigned int height, unsigned int width, bool wrap); //XOR an 8 or 16 pixel wide sprite onto the high resolution display and mark the rows it changed
+	void noteSound(bool on, unsigned long offset); //Add a sound event offset cycles after cycles_total
+	void scrollDisplay(int down, int right); //Move the display down or sideways, clearing what scrolls in, and mark the rows that changed
+	//Loops that can't end before the timers tick or a key changes, and so can't end inside a run
+	enum idle_loop {
+		IDLE_NONE, //Not an idle loop
+		IDLE_JUMP, //1NNN jumping to itself
+		IDLE_POLL //FX07, then 3XNN or 4XNN on the same VX, then 1NNN back to the FX07
+	};
+	idle_loop idleLoop(unsigned short pc) const; //Which idle loop the jump at pc closes, judged from memory alone
+	bool skipIdle(unsigned short& pc, unsigned long cycles); //Fast-forward cycles through the idle loop closed by the jump at pc, false if it's not one or the poll's skip can be taken now
+	void hashMemory(unsigned short address, unsigned short length); //Toggle the words overlapping memory in or out of memory_hash, call before and after writing them
+
+	chip8(const chip8&);
+	chip8& operator=(const chip8&);
+	friend class chip8_jit;
 };
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include <string.h>
+#include <stdint.h>
+#include <algorithm>
+#include "chip8_disasm.h"
+
+//Nothing analyzed
+chip8_disasm::chip8_disasm() : memory(NULL) {
+	memset(marks, 0, sizeof(marks));
+	memset(kinds, BYTE_UNKNOWN, sizeof(kinds));
+	memset(block_index, 0xFF, sizeof(block_index));
+}
+
+//Analyze memory holding rom_size bytes of ROM at 0x200
+void chip8_disasm::analyze(const unsigned char memory[4096], unsigned long rom_size, unsigned short entry) {
+	this->memory = memory;
+	memset(marks, 0, sizeof(marks));
+	memset(kinds, BYTE_UNKNOWN, sizeof(kinds));
+	memset(block_index, 0xFF, sizeof(block_index));
+	blocks.clear();
+	calls.clear();
+
+	trace(entry & 0xFFF);
+	buildBlocks();
+
+	//Code wins over sprites, anything else in the ROM is data. Written without branches so it vectorizes.
+	int rom_end = 0x200 + (int)std::min(rom_size, 4096UL - 0x200);
+	for (int address = 0; address < 4096; ++address) {
+		unsigned char data = (marks[address] & MARK_DATA) || (address >= 0x200 && address < rom_end) ? (unsigned char)BYTE_DATA : (unsigned char)BYTE_UNKNOWN;
+		unsigned char other = marks[address] & MARK_SPRITE ? (unsigned char)BYTE_SPRITE : data;
+		kinds[address] = kinds[address] == BYTE_CODE ? (unsigned char)BYTE_CODE : other;
+	}
+}
+
+//Decode the opcode at address
+chip8_instruction chip8_disasm::decode(unsigned short address) const {
+	return decodeOpcode((memory[address] << 8) | memory[address + 1]);
+}
+
+//Mark every opcode reachable from entry and the bytes they draw, read and write
+void chip8_disasm::trace(unsigned short entry) {
+	unsigned short pending[4096]; //Every address is pushed at most once, when it's first made a leader
+	int count = 0;
+	marks[entry] |= MARK_LEADER;
+	pending[count++] = entry;
+
+	while (count > 0) {
+		unsigned short pc = pending[--count];
+		int index = -1; //I while it's known on this path, -1 otherwise
+
+		//Walk straight-line code until it leaves or runs into code already seen
+		for (;;) {
+			if (pc >= 4095) {
+				break;
+			}
+			if (marks[pc] & MARK_OPCODE) {
+				marks[pc] |= MARK_LEADER; //Code reached from more than one place starts a block
+				break;
+			}
+			chip8_instruction op = decode(pc);
+			unsigned char flow = OP_INFO[op.handler].flow;
+			if (flow & FLOW_STOP) {
+				break; //Unknown opcodes are left as data
+			}
+			marks[pc] |= MARK_OPCODE;
+			kinds[pc] = kinds[pc + 1] = BYTE_CODE;
+			unsigned short next = pc + 2;
+
+			//Follow I so the bytes it points at can be classified
+			switch (op.handler) {
+			case OP_ANNN: index = op.nnn; break;
+			case OP_FX1E: case OP_FX29: case OP_FX30: index = -1; break;
+			case OP_DXYN: case OP_DXY0:
+				if (index >= 0) {
+					int length = op.handler == OP_DXY0 ? 32 : op.nn & 0xF; //DXY0 draws 16x16 in high resolution
+					for (int i = 0; i < length && index + i < 4096; ++i) {
+						marks[index + i] |= MARK_SPRITE;
+					}
+				} break;
+			case OP_FX33: case OP_FX55: case OP_FX65:
+				if (index >= 0) {
+					int length = op.handler == OP_FX33 ? 3 : op.x + 1;
+					for (int i = 0; i < length && index + i < 4096; ++i) {
+						marks[index + i] |= MARK_DATA;
+					}
+				}
+				index = -1; //FX55 and FX65 move I on some interpreters
+				break;
+			}
+
+			//Queue every other address control can continue at
+			unsigned short targets[2];
+			int target_count = 0;
+			if (flow & (FLOW_JUMP | FLOW_CALL)) {
+				targets[target_count++] = op.nnn;
+			}
+			if (flow & FLOW_CALL) {
+				marks[op.nnn] |= MARK_CALLED;
+				chip8_call call = { pc, op.nnn };
+				calls.push_back(call);
+			}
+			if (flow & FLOW_SKIP) {
+				targets[target_count++] = next + 2;
+			}
+			if (flow & (FLOW_CALL | FLOW_SKIP)) {
+				marks[next & 0xFFF] |= MARK_LEADER; //Where the call returns to, or the skip doesn't skip to
+			}
+			for (int i = 0; i < target_count; ++i) {
+				unsigned short target = targets[i] & 0xFFF;
+				if (!(marks[target] & MARK_LEADER)) {
+					marks[target] |= MARK_LEADER;
+					pending[count++] = target;
+				}
+			}
+			if (flow & (FLOW_JUMP | FLOW_RETURN)) {
+				break;
+			}
+			pc = next;
+		}
+	}
+	std::sort(calls.begin(), calls.end(), [](const chip8_call& a, const chip8_call& b) { return a.site < b.site; });
+}
+
+//Split the marked opcodes into blocks
+void chip8_disasm::buildBlocks() {
+	const uint64_t LEADERS = 0x0202020202020202ULL; //MARK_LEADER in each of 8 bytes
+	for (unsigned short address = 0; address < 4096; ++address) {
+		if ((address & 7) == 0) {
+			uint64_t word;
+			memcpy(&word, marks + address, sizeof(word));
+			if ((word & LEADERS) == 0) {
+				address += 7; //Skip 8 addresses without a leader at once
+				continue;
+			}
+		}
+		if ((marks[address] & (MARK_OPCODE | MARK_LEADER)) != (MARK_OPCODE | MARK_LEADER)) {
+			continue;
+		}
+		chip8_block block;
+		block.start = address;
+		block.flow = 0;
+		block.successor_count = 0;
+		block.callee = 0;
+
+		//Extend the block until an opcode changes control flow or the next one starts another block
+		unsigned short pc = address;
+		for (;;) {
+			chip8_instruction op = decode(pc);
+			unsigned char flow = OP_INFO[op.handler].flow;
+			unsigned short next = pc + 2;
+			if (flow != 0) {
+				block.flow = flow;
+				if (flow & FLOW_JUMP) {
+					block.successors[block.successor_count++] = op.nnn;
+				}
+				if (flow & FLOW_CALL) {
+					block.callee = op.nnn;
+				}
+				if (flow & (FLOW_CALL | FLOW_SKIP)) {
+					block.successors[block.successor_count++] = next & 0xFFF;
+				}
+				if (flow & FLOW_SKIP) {
+					block.successors[block.successor_count++] = (next + 2) & 0xFFF;
+				}
+				pc = next;
+				break;
+			}
+			pc = next;
+			if (pc >= 4095 || !(marks[pc] & MARK_OPCODE) || (marks[pc] & MARK_LEADER)) {
+				if (pc < 4095 && (marks[pc] & MARK_OPCODE)) {
+					block.successors[block.successor_count++] = pc; //Falls into the next block
+				}
+				break;
+			}
+		}
+		block.end = pc;
+		block_index[address] = (short)blocks.size();
+		blocks.push_back(block);
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include "chip8_ops.h"
+
+//What a byte of memory was found to be
+enum {
+	BYTE_UNKNOWN, //Outside the ROM and never reached
+	BYTE_CODE, //Part of an opcode reachable from the entry point
+	BYTE_DATA, //In the ROM but never reached as code
+	BYTE_SPRITE //Drawn by a DXYN whose I is known from an ANNN earlier on the same path
+};
+
+//Straight-line code entered only at its start and left only at its end
+struct chip8_block {
+	unsigned short start; //Address of the first opcode
+	unsigned short end; //Address after the last opcode
+	unsigned char flow; //FLOW_ flags of the last opcode, 0 if the block runs into the next one
+	unsigned char successor_count; //Blocks control can continue at, not counting the callee of a 2NNN
+	unsigned short successors[2]; //Start addresses of those blocks
+	unsigned short callee; //Subroutine a block ending in 2NNN calls
+};
+
+//A 2NNN found in the ROM
+struct chip8_call {
+	unsigned short site; //Address of the 2NNN
+	unsigned short target; //Subroutine it calls
+};
+
+//Recovers code, data, basic blocks and the call graph of a ROM by following control flow from its entry point.
+//Only the bytes of opcodes that can be reached are code. BNNN is followed to NNN as if V0 were 0.
+class chip8_disasm {
+public:
+	chip8_disasm(); //Nothing analyzed
+
+	void analyze(const unsigned char memory[4096], unsigned long rom_size, unsigned short entry = 0x200); //Analyze memory holding rom_size bytes of ROM at 0x200
+
+	unsigned char kind(unsigned short address) const { return kinds[address & 0xFFF]; } //BYTE_ kind of one byte
+	bool isOpcode(unsigned short address) const { return (marks[address & 0xFFF] & MARK_OPCODE) != 0; } //True if a reachable opcode starts here
+	bool isSubroutine(unsigned short address) const { return (marks[address & 0xFFF] & MARK_CALLED) != 0; } //True if a 2NNN calls here
+	int blockAt(unsigned short address) const { return block_index[address & 0xFFF]; } //Index of the block starting here, -1 if none
+	const std::vector<chip8_block>& getBlocks() const { return blocks; } //Every block, in address order
+	const std::vector<chip8_call>& getCalls() const { return calls; } //Every call site, in address order
+
+private:
+	//Per address marks
+	enum {
+		MARK_OPCODE = 1, //A reachable opcode starts here
+		MARK_LEADER = 2, //A block starts here
+		MARK_CALLED = 4, //A subroutine starts here
+		MARK_SPRITE = 8, //Drawn as a sprite
+		MARK_DATA = 16 //Read or written by FX33, FX55 or FX65
+	};
+
+	const unsigned char* memory; //Memory being analyzed
+	unsigned char marks[4096]; //MARK_ flags per address
+	unsigned char kinds[4096]; //BYTE_ kind per address
+	short block_index[4096]; //Block starting at each address, -1 if none
+	std::vector<chip8_block> blocks;
+	std::vector<chip8_call> calls;
+
+	chip8_instruction decode(unsigned short address) const; //Decode the opcode at address
+	void trace(unsigned short entry); //Mark every opcode reachable from entry and the bytes they draw, read and write
+	void buildBlocks(); //Split the marked opcodes into blocks
+};
@@ -0,0 +1,541 @@
+#include <stdlib.h>
+#include <string.h>
+#if defined(__x86_64__) || defined(_M_X64)
+#define JIT_X64
+#endif
+#if !defined(JIT_X64)
+#elif defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#include "chip8.h"
+#include "chip8_jit.h"
+#include "chip8_ops.h"
+
+const unsigned long BUFFER_SIZE = 256 * 1024; //Size of the executable code buffer
+const unsigned long MAX_BLOCK_SIZE = 8192; //Upper bound on the bytes one block can emit
+const int MAX_BLOCK_CYCLES = 64; //Longest block translated in one go
+const int MAX_BLOCK_BYTES = MAX_BLOCK_CYCLES * 2 + 2; //Most memory one block is translated from, the instruction it stopped before included
+
+//Host registers by number. V registers a block uses often live in the cached ones for the whole block.
+enum host_register { AL = 0, CL = 1, DL = 2 };
+static const unsigned char CACHED[8] = { 3, 5, 6, 7, 12, 13, 14, 15 }; //rbx, rbp, rsi, rdi, r12 to r15, callee-saved so the entry stub keeps them
+
+//Called through the entry stub: runs blocks from the pc in base until one doesn't fit in budget or can't chain,
+//leaves the cycles still to run in budget and returns the pc it stopped at
+typedef unsigned int (*jit_entry)(unsigned char* base, void* const* entries, uint64_t* budget);
+
+//Writes x86-64 machine code. The chip8 object is addressed through r8, I is kept in r9d, the cycles left in r10,
+//the entries table in r11, and the next pc is passed in eax. Byte registers always get a REX prefix so the cached
+//registers can be used as sil, dil and bpl.
+struct emitter {
+	unsigned char* p;
+
+	void byte(unsigned char b) { *p++ = b; }
+	void word(unsigned short w) { memcpy(p, &w, 2); p += 2; }
+	void dword(unsigned int d) { memcpy(p, &d, 4); p += 4; }
+
+	//Instruction with a byte register and a [r8 + disp32] operand, reg is the register or the ModRM reg field
+	void mem(unsigned char opcode, unsigned char reg, int disp) {
+		byte(0x41 | ((reg & 8) >> 1)); byte(opcode); byte(0x80 | ((reg & 7) << 3)); dword(disp);
+	}
+	//Instruction on two byte registers, opcode is the op r/m8, r8 form. Moving a register to itself emits nothing.
+	void reg(unsigned char opcode, unsigned char dst, unsigned char src) {
+		if (opcode == 0x88 && dst == src) {
+			return;
+		}
+		byte(0x40 | ((src & 8) >> 1) | (dst >> 3)); byte(opcode); byte(0xC0 | ((src & 7) << 3) | (dst & 7));
+	}
+	//Instruction on a byte register selected by the ModRM reg field ext, like 80 /ext ib
+	void regExt(unsigned char opcode, unsigned char ext, unsigned char dst) {
+		byte(0x40 | (dst >> 3)); byte(opcode); byte(0xC0 | (ext << 3) | (dst & 7));
+	}
+	void load(unsigned char dst, int disp) { byte(0x41 | ((dst & 8) >> 1)); byte(0x0F); byte(0xB6); byte(0x80 | ((dst & 7) << 3)); dword(disp); } //movzx dst, byte [r8 + disp]
+	void store(int disp, unsigned char src) { mem(0x88, src, disp); } //mov [r8 + disp], src
+	void mov_imm(unsigned char dst, unsigned char imm) { byte(0x40 | (dst >> 3)); byte(0xB0 + (dst & 7)); byte(imm); } //mov dst, imm8
+	void movzx_eax(unsigned char src) { byte(0x40 | (src >> 3)); byte(0x0F); byte(0xB6); byte(0xC0 | (src & 7)); } //movzx eax, src
+	void setc(unsigned char dst, bool carry) { byte(0x40 | (dst >> 3)); byte(0x0F); byte(carry ? 0x92 : 0x93); byte(0xC0 | (dst & 7)); } //setc/setnc dst
+	void mov_eax(unsigned int imm) { byte(0xB8); dword(imm); } //mov eax, imm32
+	void mov_ecx(unsigned int imm) { byte(0xB9); dword(imm); } //mov ecx, imm32
+	void cmov_eax_ecx(bool equal) { byte(0x0F); byte(equal ? 0x44 : 0x45); byte(0xC1); } //cmove/cmovne eax, ecx
+	unsigned char* jcc(bool equal) { byte(0x0F); byte(equal ? 0x84 : 0x85); dword(0); return p; } //je/jne rel32, returns the end to patch from
+	unsigned char* jmp() { byte(0xE9); dword(0); return p; } //jmp rel32, returns the end to patch from
+	void jb(const unsigned char* to) { byte(0x0F); byte(0x82); dword((unsigned int)(to - (p + 4))); } //jb rel32
+	static void patch(unsigned char* end, const unsigned char* to) { unsigned int rel = (unsigned int)(to - end); memcpy(end - 4, &rel, 4); }
+	void chain(unsigned short target) { mov_eax(target); byte(0x41); byte(0xFF); byte(0xA3); dword(target * 8); } //mov eax, target; jmp [r11 + target * 8]
+	void chain_eax() { byte(0x41); byte(0xFF); byte(0x24); byte(0xC3); } //jmp [r11 + rax * 8]
+
+	//Pick pc + 4 if the last compare matched (equal or not equal), otherwise pc + 2
+	void skip(unsigned short address, bool equal) {
+		mov_eax(address + 2);
+		mov_ecx(address + 4);
+		cmov_eax_ecx(equal);
+	}
+};
+
+//Where each V register of a block lives while it runs
+struct register_map {
+	emitter& e;
+	int off_V;
+	unsigned char host[16]; //Cached register holding V, 0 if it stays in memory
+	bool dirty[16]; //Written by the block, stored back when it ends
+
+	//Register holding V[i], loaded into scratch if it isn't cached
+	unsigned char read(int i, unsigned char scratch) {
+		if (host[i] != 0) {
+			return host[i];
+		}
+		e.load(scratch, off_V + i);
+		return scratch;
+	}
+	//Set V[i] from a register
+	void write(int i, unsigned char src) {
+		if (host[i] == 0) {
+			e.store(off_V + i, src);
+		} else if (host[i] != src) {
+			e.reg(0x88, host[i], src);
+		}
+		dirty[i] = true;
+	}
+	//V[i] = V[i] op V[j], opcode is the op r/m8, r8 form
+	void apply(unsigned char opcode, int i, int j) {
+		unsigned char src = read(j, DL);
+		if (host[i] != 0) {
+			e.reg(opcode, host[i], src);
+		} else {
+			e.mem(opcode, src, off_V + i);
+		}
+		dirty[i] = true;
+	}
+	//Instruction with an ext form on V[i], like 80 /ext ib or D0 /ext
+	void applyExt(unsigned char opcode, unsigned char ext, int i) {
+		if (host[i] != 0) {
+			e.regExt(opcode, ext, host[i]);
+		} else {
+			e.mem(opcode, ext, off_V + i);
+		}
+		dirty[i] = dirty[i] || ext != 7; //Everything but cmp writes
+	}
+	//Zero-extend V[i] into eax
+	void readEax(int i) {
+		if (host[i] != 0) {
+			e.movzx_eax(host[i]);
+		} else {
+			e.load(AL, off_V + i);
+		}
+	}
+};
+
+//Opcodes that don't change control flow
+static bool straight(const chip8_instruction& op) {
+	switch (op.handler) {
+	case OP_6XNN: case OP_7XNN: case OP_8XY0: case OP_8XY1: case OP_8XY2: case OP_8XY3: case OP_8XY4:
+	case OP_8XY5: case OP_8XY6: case OP_8XY7: case OP_8XYE: case OP_ANNN: case OP_FX1E: case OP_FX29:
+		return true;
+	default:
+		return false;
+	}
+}
+
+//Opcodes that skip the next instruction
+static bool skips(const chip8_instruction& op) {
+	switch (op.handler) {
+	case OP_3XNN: case OP_4XNN: case OP_5XY0: case OP_9XY0: case OP_EX9E: case OP_EXA1:
+		return true;
+	default:
+		return false;
+	}
+}
+
+//Allocate the code buffer
+chip8_jit::chip8_jit(const chip8& owner) {
+	buffer = NULL;
+	exit_stub = NULL;
+	stubs = 0;
+	used = 0;
+	const unsigned char* base = (const unsigned char*)&owner;
+	off_V = (int)(owner.V - base);
+	off_I = (int)((const unsigned char*)&owner.I - base);
+	off_pc = (int)((const unsigned char*)&owner.pc - base);
+	off_opcode = (int)((const unsigned char*)&owner.opcode - base);
+	off_key = (int)(owner.key - base);
+	off_key_read = (int)(owner.key_read - base);
+	#if defined(JIT_X64) && defined(_WIN32)
+	buffer = (unsigned char*)VirtualAlloc(NULL, BUFFER_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
+	#elif defined(JIT_X64)
+	void* mapped = mmap(NULL, BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	buffer = mapped == MAP_FAILED ? NULL : (unsigned char*)mapped;
+	#endif
+	if (buffer != NULL) {
+		emitStubs();
+	}
+	flush();
+}
+
+//Free the code buffer
+chip8_jit::~chip8_jit() {
+	#if defined(JIT_X64) && defined(_WIN32)
+	if (buffer != NULL) {
+		VirtualFree(buffer, 0, MEM_RELEASE);
+	}
+	#elif defined(JIT_X64)
+	if (buffer != NULL) {
+		munmap(buffer, BUFFER_SIZE);
+	}
+	#endif
+}
+
+//Write the entry and exit stubs at the start of the buffer. Entry saves the callee-saved registers blocks cache
+//V in, loads the registers every block relies on and jumps to the block at pc. Exit undoes it.
+void chip8_jit::emitStubs() {
+	emitter e;
+	e.p = buffer;
+	e.byte(0x53); e.byte(0x55); //push rbx; push rbp
+	e.byte(0x41); e.byte(0x54); e.byte(0x41); e.byte(0x55); e.byte(0x41); e.byte(0x56); e.byte(0x41); e.byte(0x57); //push r12 to r15
+	#if defined(_WIN32)
+	e.byte(0x56); e.byte(0x57); //push rsi; push rdi
+	e.byte(0x41); e.byte(0x50); //push r8, the budget
+	e.byte(0x49); e.byte(0x89); e.byte(0xD3); //mov r11, rdx
+	e.byte(0x4D); e.byte(0x8B); e.byte(0x10); //mov r10, [r8]
+	e.byte(0x49); e.byte(0x89); e.byte(0xC8); //mov r8, rcx
+	#else
+	e.byte(0x52); //push rdx, the budget
+	e.byte(0x49); e.byte(0x89); e.byte(0xF3); //mov r11, rsi
+	e.byte(0x4C); e.byte(0x8B); e.byte(0x12); //mov r10, [rdx]
+	e.byte(0x49); e.byte(0x89); e.byte(0xF8); //mov r8, rdi
+	#endif
+	e.byte(0x45); e.byte(0x0F); e.byte(0xB7); e.byte(0x88); e.dword(off_I); //movzx r9d, word [r8 + I]
+	e.byte(0x41); e.byte(0x0F); e.byte(0xB7); e.byte(0x80); e.dword(off_pc); //movzx eax, word [r8 + pc]
+	e.chain_eax();
+
+	exit_stub = e.p;
+	e.byte(0x66); e.byte(0x45); e.byte(0x89); e.byte(0x88); e.dword(off_I); //mov [r8 + I], r9w
+	e.byte(0x5A); //pop rdx
+	e.byte(0x4C); e.byte(0x89); e.byte(0x12); //mov [rdx], r10
+	#if defined(_WIN32)
+	e.byte(0x5F); e.byte(0x5E); //pop rdi; pop rsi
+	#endif
+	e.byte(0x41); e.byte(0x5F); e.byte(0x41); e.byte(0x5E); e.byte(0x41); e.byte(0x5D); e.byte(0x41); e.byte(0x5C); //pop r15 to r12
+	e.byte(0x5D); e.byte(0x5B); //pop rbp; pop rbx
+	e.byte(0xC3); //ret
+	stubs = (unsigned long)(e.p - buffer);
+}
+
+//True if the host can run translated code
+bool chip8_jit::available() {
+	return buffer != NULL;
+}
+
+//Drop every translated block
+void chip8_jit::flush() {
+	memset(blocks, 0, sizeof(blocks));
+	memset(covered, 0, sizeof(covered));
+	for (int i = 0; i < ENTRIES; ++i) {
+		entries[i] = exit_stub;
+	}
+	used = stubs;
+}
+
+//Forget the block starting at address, jumps to it leave translated code again
+void chip8_jit::drop(unsigned short address) {
+	memset(&blocks[address], 0, sizeof(blocks[address]));
+	entries[address] = exit_stub;
+}
+
+//Drop the blocks translated from memory that is written. Blocks never wrap around memory, but writes can.
+void chip8_jit::invalidate(unsigned short address, unsigned short length) {
+	address &= 0xFFF;
+	if (address + length > 4096) {
+		invalidate(0, (unsigned short)(address + length - 4096));
+		length = (unsigned short)(4096 - address);
+	}
+	bool hit = false;
+	for (int i = address; i < address + length && !hit; ++i) {
+		hit = covered[i] != 0;
+	}
+	if (!hit) {
+		return;
+	}
+	for (int at = address - MAX_BLOCK_BYTES + 1; at < address + length; ++at) {
+		if (at >= 0 && blocks[at].translated && at + blocks[at].size > address) {
+			drop((unsigned short)at);
+		}
+	}
+}
+
+//Run translated blocks from pc until one doesn't fit in cycles, returns cycles run. Blocks jump straight to the
+//next one through entries, control only comes back here to translate a block or when one can't run.
+unsigned long chip8_jit::run(chip8& owner, unsigned long cycles) {
+	uint64_t budget = cycles;
+	while (owner.pc <= 0xFFF) {
+		block& b = blocks[owner.pc];
+		if (!b.translated && !translate(owner, owner.pc)) {
+			break;
+		}
+		if (b.code == NULL || b.cycles > budget) {
+			break;
+		}
+		owner.pc = (unsigned short)((jit_entry)buffer)((unsigned char*)&owner, entries, &budget);
+	}
+	return (unsigned long)(cycles - budget);
+}
+
+//Opcode at pc
+unsigned short chip8_jit::fetch(const chip8& owner, unsigned short pc) {
+	return (unsigned short)(owner.memory[pc] << 8 | owner.memory[pc + 1]);
+}
+
+//True if the opcode at pc can be translated. Code is only emitted for the default quirks, opcodes other quirk
+//profiles change are left to the interpreter, and jumps closing idle loops are left for runCycles to fast-forward.
+bool chip8_jit::translatable(const chip8& owner, unsigned short pc) {
+	chip8_instruction op = decodeOpcode(fetch(owner, pc));
+	bool quirked = owner.quirks != chip8::QUIRKS_OCTOCHIP && (op.handler == OP_8XY1 || op.handler == OP_8XY2 ||
+		op.handler == OP_8XY3 || op.handler == OP_8XY6 || op.handler == OP_8XYE || op.handler == OP_BNNN);
+	if (quirked) {
+		return false;
+	}
+	return straight(op) || skips(op) || op.handler == OP_BNNN || (op.handler == OP_1NNN && owner.idleLoop(pc) == chip8::IDLE_NONE);
+}
+
+//Translate the block starting at address. The block is scanned first so the V registers it uses most can be
+//cached in host registers for all of it. A skip over a straight opcode that the block carries on after is
+//compiled as a branch inside the block, its cycle is given back when the skip is taken.
+bool chip8_jit::translate(chip8& owner, unsigned short address) {
+	if (buffer == NULL) {
+		return false;
+	}
+	if (BUFFER_SIZE - used < MAX_BLOCK_SIZE) {
+		flush();
+	}
+
+	block& b = blocks[address];
+	b.translated = true;
+	b.code = NULL;
+	b.cycles = 0;
+
+	chip8_instruction ops[MAX_BLOCK_CYCLES];
+	bool inlined[MAX_BLOCK_CYCLES]; //Skip compiled as a branch over the next opcode
+	int count = 0;
+	bool stopped = false; //Ended before an opcode left to the interpreter
+	unsigned short pc = address;
+	while (count < MAX_BLOCK_CYCLES && pc + 1 <= 0xFFF) {
+		chip8_instruction op = decodeOpcode(fetch(owner, pc));
+		if (!translatable(owner, pc)) {
+			stopped = true;
+			break;
+		}
+		ops[count] = op;
+		inlined[count] = false;
+		++count;
+		pc += 2;
+		if (skips(op)) {
+			inlined[count - 1] = count + 2 <= MAX_BLOCK_CYCLES && pc + 3 <= 0xFFF && straight(decodeOpcode(fetch(owner, pc))) &&
+				translatable(owner, pc) && translatable(owner, pc + 2);
+		}
+		if (op.handler == OP_1NNN || op.handler == OP_BNNN || (skips(op) && !inlined[count - 1])) {
+			break;
+		}
+	}
+	b.size = (unsigned short)(count * 2 + (stopped ? 2 : 0));
+	for (int i = 0; i < b.size; ++i) {
+		covered[address + i] = 1;
+	}
+	if (count == 0) {
+		return true;
+	}
+
+	//Cache the V registers used more than once, most used first
+	emitter e;
+	e.p = buffer + used;
+	register_map v = { e, off_V, { 0 }, { false } };
+	int uses[16] = { 0 };
+	for (int i = 0; i < count; ++i) {
+		const chip8_instruction& op = ops[i];
+		if (op.handler == OP_BNNN) {
+			++uses[0];
+		} else if (op.handler != OP_1NNN && op.handler != OP_ANNN) {
+			++uses[op.x];
+		}
+		if ((op.handler >= OP_8XY0 && op.handler <= OP_8XYE) || op.handler == OP_5XY0 || op.handler == OP_9XY0) {
+			++uses[op.y];
+		}
+		if (op.handler >= OP_8XY4 && op.handler <= OP_8XYE) {
+			++uses[0xF];
+		}
+	}
+	for (int c = 0; c < 8; ++c) {
+		int best = -1;
+		for (int i = 0; i < 16; ++i) {
+			if (v.host[i] == 0 && uses[i] >= 2 && (best < 0 || uses[i] > uses[best])) {
+				best = i;
+			}
+		}
+		if (best < 0) {
+			break;
+		}
+		v.host[best] = CACHED[c];
+	}
+
+	//Every block starts with eax holding its own pc, so running out of cycles can go straight to the exit stub
+	unsigned char* code = e.p;
+	e.byte(0x49); e.byte(0x83); e.byte(0xFA); e.byte((unsigned char)count); //cmp r10, cycles
+	e.jb(exit_stub);
+	e.byte(0x49); e.byte(0x83); e.byte(0xEA); e.byte((unsigned char)count); //sub r10, cycles
+	for (int i = 0; i < 16; ++i) {
+		if (v.host[i] != 0) {
+			e.load(v.host[i], off_V + i);
+		}
+	}
+
+	unsigned char* refunds[MAX_BLOCK_CYCLES]; //Inlined skips to patch to their refund code
+	unsigned char* joins[MAX_BLOCK_CYCLES]; //Where each of them goes back to
+	int inlines = 0;
+	unsigned char* pending = NULL; //Inlined skip waiting for the opcode it skips to be emitted
+	bool dynamic = false; //The next pc is left in eax
+	unsigned short next = pc; //The next pc when it's known
+	pc = address;
+	for (int i = 0; i < count; ++i, pc += 2) {
+		const chip8_instruction& op = ops[i];
+		switch (op.handler) {
+		case OP_1NNN: //1NNN: Jumps to address NNN
+			next = op.nnn;
+			break;
+
+		case OP_3XNN: //3XNN: Skips next instruction if VX == NN
+		case OP_4XNN: //4XNN: Skips next instruction if VX != NN
+			v.applyExt(0x80, 7, op.x); e.byte(op.nn); //cmp VX, NN
+			break;
+
+		case OP_5XY0: //5XY0: Skips next instruction if VX == VY
+		case OP_9XY0: //9XY0: Skips next instruction if VX != VY
+			e.reg(0x38, v.read(op.x, AL), v.read(op.y, DL)); //cmp VX, VY
+			break;
+
+		case OP_6XNN: //6XNN: Sets VX to NN
+			if (v.host[op.x] != 0) {
+				e.mov_imm(v.host[op.x], op.nn);
+				v.dirty[op.x] = true;
+			} else {
+				e.mem(0xC6, 0, off_V + op.x); e.byte(op.nn); //mov byte [VX], NN
+			}
+			break;
+
+		case OP_7XNN: //7XNN: Adds NN to VX (Carry flag not changed)
+			v.applyExt(0x80, 0, op.x); e.byte(op.nn); //add VX, NN
+			break;
+
+		case OP_8XY0: //8XY0: Sets VX to the value of VY
+			v.write(op.x, v.read(op.y, DL));
+			break;
+
+		case OP_8XY1: //8XY1: Sets VX to VX OR VY
+		case OP_8XY2: //8XY2: Sets VX to VX AND VY
+		case OP_8XY3: { //8XY3: Sets VX to VX XOR VY
+			static const unsigned char alu[3] = { 0x08, 0x20, 0x30 }; //or, and, xor
+			v.apply(alu[op.handler - OP_8XY1], op.x, op.y);
+			} break;
+
+		//Flag ops set VF first and then read their operands again, exactly like the interpreter, so X or Y being F behaves the same
+		case OP_8XY4: //8XY4: Adds VY to VX (Set VF to 1 when there is a carry)
+		case OP_8XY5: //8XY5: Sets VX to VX - VY (Set VF to 1 when there is no borrow)
+			e.reg(0x88, AL, v.read(op.x, AL)); //mov al, VX
+			e.reg(op.handler == OP_8XY4 ? 0x00 : 0x38, AL, v.read(op.y, DL)); //add or cmp al, VY
+			e.setc(CL, op.handler == OP_8XY4);
+			v.write(0xF, CL);
+			v.apply(op.handler == OP_8XY4 ? 0x00 : 0x28, op.x, op.y); //add or sub VX, VY
+			break;
+
+		case OP_8XY7: //8XY7: Sets VX to VY - VX (Set VF to 1 when there is no borrow)
+			e.reg(0x88, AL, v.read(op.y, AL)); //mov al, VY
+			e.reg(0x38, AL, v.read(op.x, DL)); //cmp al, VX
+			e.setc(CL, false);
+			v.write(0xF, CL);
+			e.reg(0x88, AL, v.read(op.y, AL)); //mov al, VY
+			e.reg(0x28, AL, v.read(op.x, DL)); //sub al, VX
+			v.write(op.x, AL);
+			break;
+
+		case OP_8XY6: //8XY6: Stores the least significant bit of VX in VF then shifts VX right by 1
+		case OP_8XYE: //8XYE: Stores the most significant bit of VX in VF then shifts VX to the left by 1
+			e.reg(0x88, AL, v.read(op.x, AL)); //mov al, VX
+			if (op.handler == OP_8XY6) {
+				e.byte(0x24); e.byte(0x01); //and al, 1
+			} else {
+				e.byte(0xC0); e.byte(0xE8); e.byte(0x07); //shr al, 7
+			}
+			v.write(0xF, AL);
+			v.applyExt(0xD0, op.handler == OP_8XY6 ? 5 : 4, op.x); //shr or shl VX, 1
+			break;
+
+		case OP_ANNN: //ANNN: Sets I to address NNN
+			e.byte(0x41); e.byte(0xB9); e.dword(op.nnn); //mov r9d, NNN
+			break;
+
+		case OP_BNNN: //BNNN: Jumps to address NNN + V0
+			v.readEax(0);
+			e.byte(0x05); e.dword(op.nnn); //add eax, NNN
+			dynamic = true;
+			break;
+
+		case OP_EX9E: //EX9E: Skips next instruction if the key stored in VX is pressed
+		case OP_EXA1: //EXA1: Skips next instruction if the key stored in VX is not pressed
+			v.readEax(op.x);
+			e.byte(0x83); e.byte(0xE0); e.byte(0x0F); //and eax, 0xF
+			e.byte(0x41); e.byte(0xC6); e.byte(0x84); e.byte(0x00); e.dword(off_key_read); e.byte(1); //mov byte [r8 + rax + key_read], 1
+			e.byte(0x41); e.byte(0x80); e.byte(0xBC); e.byte(0x00); e.dword(off_key); //cmp byte [r8 + rax + key], ...
+			e.byte(op.handler == OP_EX9E ? 1 : 0);
+			break;
+
+		case OP_FX1E: //FX1E: Adds VX to I (VF not affected)
+		case OP_FX29: //FX29: Sets I to the location of the sprite for the character VX from the fontset
+			v.readEax(op.x);
+			if (op.handler == OP_FX1E) {
+				e.byte(0x41); e.byte(0x01); e.byte(0xC1); //add r9d, eax
+			} else {
+				e.byte(0x44); e.byte(0x8D); e.byte(0x0C); e.byte(0x80); //lea r9d, [rax + rax * 4]
+			}
+			break;
+		}
+
+		if (pending != NULL) {
+			joins[inlines++] = e.p;
+			pending = NULL;
+		}
+		if (skips(op)) {
+			bool equal = op.handler != OP_4XNN && op.handler != OP_9XY0; //Skips when the compare is equal
+			if (inlined[i]) {
+				pending = refunds[inlines] = e.jcc(equal);
+			} else {
+				e.skip(pc, equal);
+				dynamic = true;
+			}
+		}
+	}
+
+	//Store the cached registers the block wrote and the last opcode, then go straight on to the next block
+	for (int i = 0; i < 16; ++i) {
+		if (v.host[i] != 0 && v.dirty[i]) {
+			e.store(off_V + i, v.host[i]);
+		}
+	}
+	e.byte(0x66); e.byte(0x41); e.byte(0xC7); e.byte(0x80); e.dword(off_opcode); e.word(ops[count - 1].opcode); //mov word [r8 + opcode], last opcode
+	if (dynamic) {
+		e.chain_eax();
+	} else {
+		e.chain(next);
+	}
+
+	//Taken inlined skips give back the cycle of the opcode they skipped
+	for (int i = 0; i < inlines; ++i) {
+		emitter::patch(refunds[i], e.p);
+		e.byte(0x49); e.byte(0x83); e.byte(0xC2); e.byte(0x01); //add r10, 1
+		emitter::patch(e.jmp(), joins[i]);
+	}
+
+	b.code = code;
+	b.cycles = (unsigned short)count;
+	entries[address] = code;
+	used += e.p - code;
+	return true;
+}
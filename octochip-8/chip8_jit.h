@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+
+class chip8;
+
+//Translates straight-line CHIP-8 blocks into x86-64 code. Anything it can't translate is left to the interpreter.
+//Blocks keep the V registers they use most in host registers, jump straight to the next block while the cycles
+//last, and are dropped one at a time when the memory they were translated from is written.
+class chip8_jit {
+public:
+	chip8_jit(const chip8& owner); //Allocate the code buffer
+	~chip8_jit(); //Free the code buffer
+
+	bool available(); //True if the host can run translated code
+	unsigned long run(chip8& owner, unsigned long cycles); //Run translated blocks from pc until one doesn't fit in cycles, returns cycles run
+	void flush(); //Drop every translated block
+	void invalidate(unsigned short address, unsigned short length); //Drop the blocks translated from memory that is written
+
+private:
+	static const int ENTRIES = 0x1100; //Every pc a block can go on to, BNNN reaches 0xFFF + 0xFF
+
+	//Translated code for one start address
+	struct block {
+		unsigned char* code; //Entry point of the block, NULL if not translated
+		unsigned short cycles; //Most instructions one run of the block executes, 0 if nothing here can be translated
+		unsigned short size; //Bytes of memory it was translated from, the instruction it stopped before included
+		bool translated; //True once translation has been attempted
+	};
+
+	block blocks[4096]; //Block for every start address
+	void* entries[ENTRIES]; //Code a block jumps to for each pc, the exit stub until a block there is translated
+	unsigned char covered[4096]; //Memory bytes that some block was translated from since the last flush
+	unsigned char* buffer; //Executable code buffer, the entry and exit stubs first
+	unsigned char* exit_stub; //Saves I and the cycles left and returns the pc in eax, where blocks go when they can't chain
+	unsigned long stubs; //Bytes of buffer taken by the stubs, blocks are written after them
+	unsigned long used; //Bytes of buffer in use
+	int off_V, off_I, off_pc, off_opcode, off_key, off_key_read; //Offsets of the state translated code uses from the start of the chip8 object
+
+	void emitStubs(); //Write the entry and exit stubs at the start of the buffer
+	static unsigned short fetch(const chip8& owner, unsigned short pc); //Opcode at pc
+	static bool translatable(const chip8& owner, unsigned short pc); //True if the opcode at pc can be translated
+	bool translate(chip8& owner, unsigned short address); //Translate the block starting at address
+	void drop(unsigned short address); //Forget the block starting at address, jumps to it leave translated code again
+
+	chip8_jit(const chip8_jit&);
+	chip8_jit& operator=(const chip8_jit&);
+};
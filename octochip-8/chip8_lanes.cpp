@@ -0,0 +1,674 @@
+#include <stdio.h>
+#include <string.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "chip8_lanes.h"
+#include "chip8_ops.h"
+
+extern unsigned char chip8_fontset[80];
+extern unsigned char chip8_bigfont[160];
+
+//Index of the lowest lane in a non-empty mask
+static inline int lowestLane(uint32_t mask) {
+	#if defined(__GNUC__)
+	return __builtin_ctz(mask);
+	#else
+	int lane = 0;
+	while ((mask & 1) == 0) {
+		mask >>= 1;
+		++lane;
+	}
+	return lane;
+	#endif
+}
+
+#if defined(__AVX2__)
+//Expand a lane mask to 0xFF in every selected byte
+static inline __m256i byteMask(uint32_t mask) {
+	const __m256i spread = _mm256_setr_epi8(
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1,
+		2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3);
+	const __m256i bits = _mm256_set1_epi64x(0x8040201008040201LL);
+	__m256i bytes = _mm256_shuffle_epi8(_mm256_set1_epi32((int)mask), spread);
+	return _mm256_cmpeq_epi8(_mm256_and_si256(bytes, bits), bits);
+}
+
+//Expand the low 16 bits of a lane mask to 0xFFFF in every selected word
+static inline __m256i wordMask(uint32_t mask) {
+	const __m256i bits = _mm256_setr_epi16(
+		0x0001, 0x0002, 0x0004, 0x0008, 0x0010, 0x0020, 0x0040, 0x0080,
+		0x0100, 0x0200, 0x0400, 0x0800, 0x1000, 0x2000, 0x4000, (short)0x8000);
+	return _mm256_cmpeq_epi16(_mm256_and_si256(_mm256_set1_epi16((short)mask), bits), bits);
+}
+
+//Store value into the selected bytes of a lane row
+static inline void storeBytes(unsigned char* row, __m256i value, __m256i mask) {
+	__m256i old = _mm256_loadu_si256((const __m256i*)row);
+	_mm256_storeu_si256((__m256i*)row, _mm256_blendv_epi8(old, value, mask));
+}
+
+//Store lo into the first 16 and hi into the last 16 words of a lane row, selected lanes only
+static inline void storeWords(unsigned short* row, uint32_t group, __m256i lo, __m256i hi) {
+	__m256i old_lo = _mm256_loadu_si256((const __m256i*)row);
+	__m256i old_hi = _mm256_loadu_si256((const __m256i*)(row + 16));
+	_mm256_storeu_si256((__m256i*)row, _mm256_blendv_epi8(old_lo, lo, wordMask(group)));
+	_mm256_storeu_si256((__m256i*)(row + 16), _mm256_blendv_epi8(old_hi, hi, wordMask(group >> 16)));
+}
+
+//Lanes whose word in a lane row equals value
+static inline uint32_t equalWords(const unsigned short* row, unsigned short value) {
+	__m256i match = _mm256_set1_epi16((short)value);
+	__m256i lo = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)row), match);
+	__m256i hi = _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i*)(row + 16)), match);
+	//Packing interleaves the 128-bit halves, the permute puts the lanes back in order
+	__m256i bytes = _mm256_permute4x64_epi64(_mm256_packs_epi16(lo, hi), 0xD8);
+	return (uint32_t)_mm256_movemask_epi8(bytes);
+}
+#else
+//Lanes whose word in a lane row equals value
+static inline uint32_t equalWords(const unsigned short* row, unsigned short value) {
+	uint32_t mask = 0;
+	for (int lane = 0; lane < chip8_lanes::LANES; ++lane) {
+		mask |= (uint32_t)(row[lane] == value) << lane;
+	}
+	return mask;
+}
+#endif
+
+//Construct with nothing loaded
+chip8_lanes::chip8_lanes() {
+	quirks = chip8::QUIRKS_OCTOCHIP;
+	init();
+}
+
+//Initialize data
+void chip8_lanes::init() {
+	memset(V, 0, sizeof(V));
+	memset(I, 0, sizeof(I));
+	memset(opcode, 0, sizeof(opcode));
+	memset(delay_timer, 0, sizeof(delay_timer));
+	memset(sound_timer, 0, sizeof(sound_timer));
+	memset(stack, 0, sizeof(stack));
+	memset(sp, 0, sizeof(sp));
+	memset(memory, 0, sizeof(memory));
+	memset(gfx, 0, sizeof(gfx));
+	memset(key, 0, sizeof(key));
+	memset(key_read, 0, sizeof(key_read));
+	memset(written, 0, sizeof(written));
+
+	for (int lane = 0; lane < LANES; ++lane) {
+		pc[lane] = 0x200;
+		state[lane] = LANE_RUNNING;
+		cycles_run[lane] = 0;
+		rng[lane] = lane + 1;
+		memcpy(memory[lane], chip8_fontset, sizeof(chip8_fontset));
+		memcpy(memory[lane] + 0x50, chip8_bigfont, sizeof(chip8_bigfont)); //Memory matches chip8's even though FX30 is never run
+	}
+	for (int i = 0; i < 4096; ++i) {
+		decoded[i] = decodeOpcode(memory[0][i] << 8 | memory[0][(i + 1) & 0xFFF]);
+	}
+}
+
+//Load application from file into every lane
+bool chip8_lanes::loadApplication(const char* filename) {
+	init();
+	printf("Loading file: %s\n", filename);
+
+	#pragma warning(suppress : 4996)
+	FILE* romFile = fopen(filename, "rb");
+	if (romFile == NULL) {
+		fputs("Could not open file", stderr);
+		return false;
+	}
+
+	//Anything left over means the ROM doesn't fit
+	unsigned char rom[4096 - 0x200];
+	size_t rom_size = fread(rom, 1, sizeof(rom), romFile);
+	bool fits = fgetc(romFile) == EOF;
+	fclose(romFile);
+	if (!fits) {
+		printf("Error: File too big to fit in memory.\n");
+		return false;
+	}
+	return loadFromBuffer(rom, rom_size);
+}
+
+//Load application from memory into every lane, false if it doesn't fit
+bool chip8_lanes::loadFromBuffer(const uint8_t* data, size_t size) {
+	init();
+	if (size > 4096 - 0x200) {
+		return false;
+	}
+	for (int lane = 0; lane < LANES; ++lane) {
+		memcpy(memory[lane] + 0x200, data, size);
+	}
+	for (int i = 0; i < 4096; ++i) {
+		decoded[i] = decodeOpcode(memory[0][i] << 8 | memory[0][(i + 1) & 0xFFF]);
+	}
+	return true;
+}
+
+//Quirk profile every lane runs with, loading a ROM keeps it
+void chip8_lanes::setQuirks(chip8::quirk_profile quirks) {
+	this->quirks = quirks;
+}
+
+//Seed the random numbers CXNN draws on one lane
+void chip8_lanes::seed(int lane, uint32_t seed) {
+	rng[lane] = seed != 0 ? seed : 1; //Xorshift never leaves 0
+}
+
+//What a lane is doing
+chip8_lanes::lane_state chip8_lanes::getState(int lane) {
+	return (lane_state)state[lane];
+}
+
+//Returns the registers and stack of one lane
+void chip8_lanes::getRegisters(int lane, unsigned short values[]) {
+	int i = 0;
+	for (; i < 16; ++i) { values[i] = V[i][lane]; }
+	for (; i < 32; ++i) { values[i] = stack[lane][i-16]; }
+	values[32] = opcode[lane];
+	values[33] = pc[lane];
+	values[34] = I[lane];
+	values[35] = sp[lane];
+	values[38] = delay_timer[lane];
+	values[39] = sound_timer[lane];
+}
+
+//FNV-1a hash of one lane's display, rows left to right and top to bottom
+uint64_t chip8_lanes::getFrameHash(int lane) {
+	uint64_t hash = 14695981039346656037ULL;
+	for (int y = 0; y < 32; ++y) {
+		for (int shift = 56; shift >= 0; shift -= 8) {
+			hash = (hash ^ ((gfx[lane][y] >> shift) & 0xFF)) * 1099511628211ULL;
+		}
+	}
+	return hash;
+}
+
+//Emulate one 60hz frame on every lane and tick their timers once. A lane that waits for a key sits out the
+//rest of the frame, a lane that hits an unknown opcode stops for good, like chip8::runFrame.
+void chip8_lanes::runFrame(unsigned long cyclesPerFrame) {
+	uint32_t active = 0;
+	for (int lane = 0; lane < LANES; ++lane) {
+		if (state[lane] == LANE_WAIT_KEY) {
+			state[lane] = LANE_RUNNING;
+		}
+		if (state[lane] == LANE_RUNNING) {
+			active |= 1u << lane;
+		}
+		cycles_run[lane] = 0;
+	}
+
+	unsigned long cycle = 0;
+	for (; cycle < cyclesPerFrame && active != 0; ++cycle) {
+		uint32_t stopped = step(active);
+		active &= ~stopped;
+		while (stopped != 0) {
+			int lane = lowestLane(stopped);
+			stopped &= stopped - 1;
+			cycles_run[lane] = cycle;
+		}
+	}
+	while (active != 0) {
+		int lane = lowestLane(active);
+		active &= active - 1;
+		cycles_run[lane] = cycle;
+	}
+
+	for (int lane = 0; lane < LANES; ++lane) {
+		if (state[lane] != LANE_INVALID) {
+			if (delay_timer[lane] > 0) {
+				--delay_timer[lane];
+			}
+			if (sound_timer[lane] > 0) {
+				--sound_timer[lane];
+			}
+		}
+	}
+}
+
+//Run one cycle on the active lanes, a group of lanes sharing a pc at a time
+uint32_t chip8_lanes::step(uint32_t active) {
+	uint32_t stopped = 0;
+	uint32_t remaining = active;
+	while (remaining != 0) {
+		int leader = lowestLane(remaining);
+		unsigned short address = pc[leader] & 0xFFF;
+		uint32_t group = equalWords(pc, pc[leader]) & remaining;
+		remaining &= ~group;
+
+		chip8_instruction op = decoded[address];
+		if (written[address] || written[(address + 1) & 0xFFF]) {
+			//Lanes may have stored different bytes here, lanes that don't match the leader wait for their own group
+			unsigned short next = (address + 1) & 0xFFF;
+			op = decodeOpcode(memory[leader][address] << 8 | memory[leader][next]);
+			uint32_t others = group & ~(1u << leader);
+			while (others != 0) {
+				int lane = lowestLane(others);
+				others &= others - 1;
+				if ((memory[lane][address] << 8 | memory[lane][next]) != op.opcode) {
+					group &= ~(1u << lane);
+					remaining |= 1u << lane;
+				}
+			}
+		}
+		stopped |= executeGroup(group, op);
+	}
+	return stopped;
+}
+
+//Run an opcode on every lane in group. With AVX2 the register, timer and skip opcodes run on all lanes at
+//once under a lane mask, everything else goes through executeLane one lane at a time.
+uint32_t chip8_lanes::executeGroup(uint32_t group, const chip8_instruction& op) {
+	#if defined(__AVX2__)
+	const __m256i one = _mm256_set1_epi8(1);
+	const __m256i mask = byteMask(group);
+	unsigned char* vx = V[op.x];
+	unsigned char* vy = V[op.y];
+	uint32_t skip = 0;
+	bool advance = true;
+
+	switch (op.handler) {
+	case OP_1NNN: //1NNN: Jumps to address NNN
+		storeWords(pc, group, _mm256_set1_epi16(op.nnn), _mm256_set1_epi16(op.nnn));
+		advance = false;
+		break;
+
+	case OP_3XNN: //3XNN: Skips next instruction if VX == NN
+	case OP_4XNN: { //4XNN: Skips next instruction if VX != NN
+		__m256i a = _mm256_loadu_si256((const __m256i*)vx);
+		skip = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, _mm256_set1_epi8((char)op.nn)));
+		if (op.handler == OP_4XNN) {
+			skip = ~skip;
+		}
+		} break;
+
+	case OP_5XY0: //5XY0: Skips next instruction if VX == VY
+	case OP_9XY0: { //9XY0: Skips next instruction if VX != VY
+		__m256i a = _mm256_loadu_si256((const __m256i*)vx);
+		__m256i b = _mm256_loadu_si256((const __m256i*)vy);
+		skip = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+		if (op.handler == OP_9XY0) {
+			skip = ~skip;
+		}
+		} break;
+
+	case OP_6XNN: //6XNN: Sets VX to NN
+		storeBytes(vx, _mm256_set1_epi8((char)op.nn), mask);
+		break;
+
+	case OP_7XNN: //7XNN: Adds NN to VX (Carry flag not changed)
+		storeBytes(vx, _mm256_add_epi8(_mm256_loadu_si256((const __m256i*)vx), _mm256_set1_epi8((char)op.nn)), mask);
+		break;
+
+	case OP_8XY0: //8XY0: Sets VX to the value of VY
+		storeBytes(vx, _mm256_loadu_si256((const __m256i*)vy), mask);
+		break;
+
+	case OP_8XY1: //8XY1: Sets VX to VX OR VY
+	case OP_8XY2: //8XY2: Sets VX to VX AND VY
+	case OP_8XY3: { //8XY3: Sets VX to VX XOR VY
+		__m256i a = _mm256_loadu_si256((const __m256i*)vx);
+		__m256i b = _mm256_loadu_si256((const __m256i*)vy);
+		__m256i value = op.handler == OP_8XY1 ? _mm256_or_si256(a, b) : op.handler == OP_8XY2 ? _mm256_and_si256(a, b) : _mm256_xor_si256(a, b);
+		storeBytes(vx, value, mask);
+		if (quirks & chip8::QUIRK_VF_RESET) {
+			storeBytes(V[0xF], _mm256_setzero_si256(), mask);
+		}
+		} break;
+
+	//Flag ops set VF first and then reload their operands, exactly like the interpreter, so X or Y being F behaves the same
+	case OP_8XY4: { //8XY4: Adds VY to VX (Set VF to 1 when there is a carry)
+		__m256i a = _mm256_loadu_si256((const __m256i*)vx);
+		__m256i b = _mm256_loadu_si256((const __m256i*)vy);
+		__m256i sum = _mm256_add_epi8(a, b);
+		__m256i no_carry = _mm256_cmpeq_epi8(_mm256_min_epu8(sum, a), a);
+		storeBytes(V[0xF], _mm256_andnot_si256(no_carry, one), mask);
+		a = _mm256_loadu_si256((const __m256i*)vx);
+		b = _mm256_loadu_si256((const __m256i*)vy);
+		storeBytes(vx, _mm256_add_epi8(a, b), mask);
+		} break;
+
+	case OP_8XY5: { //8XY5: Sets VX to VX - VY (Set VF to 1 when there is no borrow)
+		__m256i a = _mm256_loadu_si256((const __m256i*)vx);
+		__m256i b = _mm256_loadu_si256((const __m256i*)vy);
+		__m256i no_borrow = _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a);
+		storeBytes(V[0xF], _mm256_and_si256(no_borrow, one), mask);
+		a = _mm256_loadu_si256((const __m256i*)vx);
+		b = _mm256_loadu_si256((const __m256i*)vy);
+		storeBytes(vx, _mm256_sub_epi8(a, b), mask);
+		} break;
+
+	case OP_8XY6: { //8XY6: Stores the least significant bit of VX in VF then shifts VX right by 1
+		if (quirks & chip8::QUIRK_SHIFT_VY) {
+			storeBytes(vx, _mm256_loadu_si256((const __m256i*)vy), mask);
+		}
+		__m256i a = _mm256_loadu_si256((const __m256i*)vx);
+		storeBytes(V[0xF], _mm256_and_si256(a, one), mask);
+		a = _mm256_loadu_si256((const __m256i*)vx);
+		storeBytes(vx, _mm256_and_si256(_mm256_srli_epi16(a, 1), _mm256_set1_epi8(0x7F)), mask);
+		} break;
+
+	case OP_8XY7: { //8XY7: Sets VX to VY - VX (Set VF to 1 when there is no borrow)
+		__m256i a = _mm256_loadu_si256((const __m256i*)vx);
+		__m256i b = _mm256_loadu_si256((const __m256i*)vy);
+		__m256i no_borrow = _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), b);
+		storeBytes(V[0xF], _mm256_and_si256(no_borrow, one), mask);
+		a = _mm256_loadu_si256((const __m256i*)vx);
+		b = _mm256_loadu_si256((const __m256i*)vy);
+		storeBytes(vx, _mm256_sub_epi8(b, a), mask);
+		} break;
+
+	case OP_8XYE: { //8XYE: Stores the most significant bit of VX in VF then shifts VX to the left by 1
+		if (quirks & chip8::QUIRK_SHIFT_VY) {
+			storeBytes(vx, _mm256_loadu_si256((const __m256i*)vy), mask);
+		}
+		__m256i a = _mm256_loadu_si256((const __m256i*)vx);
+		storeBytes(V[0xF], _mm256_and_si256(_mm256_srli_epi16(a, 7), one), mask);
+		a = _mm256_loadu_si256((const __m256i*)vx);
+		storeBytes(vx, _mm256_add_epi8(a, a), mask);
+		} break;
+
+	case OP_ANNN: //ANNN: Sets I to address NNN
+		storeWords(I, group, _mm256_set1_epi16(op.nnn), _mm256_set1_epi16(op.nnn));
+		break;
+
+	case OP_FX07: //FX07: Sets VX to the value of the delay timer
+		storeBytes(vx, _mm256_loadu_si256((const __m256i*)delay_timer), mask);
+		break;
+
+	case OP_FX15: //FX15: Sets the delay timer to VX
+		storeBytes(delay_timer, _mm256_loadu_si256((const __m256i*)vx), mask);
+		break;
+
+	case OP_FX18: //FX18: Sets the sound timer to VX
+		storeBytes(sound_timer, _mm256_loadu_si256((const __m256i*)vx), mask);
+		break;
+
+	case OP_FX1E: //FX1E: Adds VX to I (VF not affected)
+	case OP_FX29: { //FX29: Sets I to the location of the sprite for the character VX from the fontset
+		__m256i a = _mm256_loadu_si256((const __m256i*)vx);
+		__m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(a));
+		__m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(a, 1));
+		if (op.handler == OP_FX1E) {
+			lo = _mm256_add_epi16(lo, _mm256_loadu_si256((const __m256i*)I));
+			hi = _mm256_add_epi16(hi, _mm256_loadu_si256((const __m256i*)(I + 16)));
+		} else {
+			lo = _mm256_mullo_epi16(lo, _mm256_set1_epi16(5));
+			hi = _mm256_mullo_epi16(hi, _mm256_set1_epi16(5));
+		}
+		storeWords(I, group, lo, hi);
+		} break;
+
+	default: { //Control flow, drawing, keys and memory differ too much between lanes, so run them one lane at a time
+		uint32_t stopped = 0;
+		uint32_t lanes = group;
+		while (lanes != 0) {
+			int lane = lowestLane(lanes);
+			lanes &= lanes - 1;
+			if (!executeLane(lane, op)) {
+				stopped |= 1u << lane;
+			}
+		}
+		return stopped;
+		}
+	}
+
+	//Every lane moves on by 2, lanes that skip by 2 more
+	if (advance) {
+		const __m256i two = _mm256_set1_epi16(2);
+		__m256i lo = _mm256_loadu_si256((const __m256i*)pc);
+		__m256i hi = _mm256_loadu_si256((const __m256i*)(pc + 16));
+		lo = _mm256_add_epi16(lo, _mm256_add_epi16(two, _mm256_and_si256(wordMask(skip), two)));
+		hi = _mm256_add_epi16(hi, _mm256_add_epi16(two, _mm256_and_si256(wordMask(skip >> 16), two)));
+		storeWords(pc, group, lo, hi);
+	}
+	storeWords(opcode, group, _mm256_set1_epi16(op.opcode), _mm256_set1_epi16(op.opcode));
+	return 0;
+	#else
+	uint32_t stopped = 0;
+	while (group != 0) {
+		int lane = lowestLane(group);
+		group &= group - 1;
+		if (!executeLane(lane, op)) {
+			stopped |= 1u << lane;
+		}
+	}
+	return stopped;
+	#endif
+}
+
+//Run an opcode on one lane, with the same semantics as chip8::execute
+bool chip8_lanes::executeLane(int lane, const chip8_instruction& op) {
+	unsigned char& vx = V[op.x][lane];
+	unsigned char& vy = V[op.y][lane];
+	unsigned char& vf = V[0xF][lane];
+	unsigned short& pc = this->pc[lane];
+	unsigned short& I = this->I[lane];
+	unsigned short& sp = this->sp[lane];
+	unsigned char* memory = this->memory[lane];
+	const bool wrap = (quirks & chip8::QUIRK_CLIP) == 0;
+	opcode[lane] = op.opcode;
+
+	switch (op.handler) {
+	case OP_00E0: //00E0: Clears the screen
+		memset(gfx[lane], 0, sizeof(gfx[lane]));
+		break;
+
+	case OP_00EE: //00EE: Returns from a subroutine
+		if (sp == 0) {
+			state[lane] = LANE_INVALID;
+			return false;
+		}
+		--sp;
+		pc = stack[lane][sp];
+		stack[lane][sp] = 0;
+		break;
+
+	case OP_1NNN: //1NNN: Jumps to address NNN
+		pc = op.nnn;
+		return true;
+
+	case OP_2NNN: //2NNN: Calls subroutine at NNN
+		if (sp == 16) {
+			state[lane] = LANE_INVALID;
+			return false;
+		}
+		stack[lane][sp] = pc;
+		++sp;
+		pc = op.nnn;
+		return true;
+
+	case OP_3XNN: //3XNN: Skips next instruction if VX == NN
+		pc += vx == op.nn ? 2 : 0;
+		break;
+
+	case OP_4XNN: //4XNN: Skips next instruction if VX != NN
+		pc += vx != op.nn ? 2 : 0;
+		break;
+
+	case OP_5XY0: //5XY0: Skips next instruction if VX == VY
+		pc += vx == vy ? 2 : 0;
+		break;
+
+	case OP_6XNN: //6XNN: Sets VX to NN
+		vx = op.nn;
+		break;
+
+	case OP_7XNN: //7XNN: Adds NN to VX (Carry flag not changed)
+		vx += op.nn;
+		break;
+
+	case OP_8XY0: //8XY0: Sets VX to the value of VY
+		vx = vy;
+		break;
+
+	case OP_8XY1: //8XY1: Sets VX to VX OR VY
+		vx |= vy;
+		vf = (quirks & chip8::QUIRK_VF_RESET) ? 0 : vf;
+		break;
+
+	case OP_8XY2: //8XY2: Sets VX to VX AND VY
+		vx &= vy;
+		vf = (quirks & chip8::QUIRK_VF_RESET) ? 0 : vf;
+		break;
+
+	case OP_8XY3: //8XY3: Sets VX to VX XOR VY
+		vx ^= vy;
+		vf = (quirks & chip8::QUIRK_VF_RESET) ? 0 : vf;
+		break;
+
+	case OP_8XY4: { //8XY4: Adds VY to VX (Set VF to 1 when there is a carry)
+		unsigned char carry = vy > (0xFF - vx);
+		vf = carry;
+		vx += vy;
+		} break;
+
+	case OP_8XY5: { //8XY5: Sets VX to VX - VY (Set VF to 1 when there is no borrow)
+		unsigned char no_borrow = vy <= vx;
+		vf = no_borrow;
+		vx -= vy;
+		} break;
+
+	case OP_8XY6: //8XY6: Stores the least significant bit of VX in VF then shifts VX right by 1
+		vx = (quirks & chip8::QUIRK_SHIFT_VY) ? vy : vx;
+		vf = vx & 0x01;
+		vx >>= 1;
+		break;
+
+	case OP_8XY7: { //8XY7: Sets VX to VY - VX (Set VF to 1 when there is no borrow)
+		unsigned char no_borrow = vx <= vy;
+		vf = no_borrow;
+		vx = vy - vx;
+		} break;
+
+	case OP_8XYE: //8XYE: Stores the most significant bit of VX in VF then shifts VX to the left by 1
+		vx = (quirks & chip8::QUIRK_SHIFT_VY) ? vy : vx;
+		vf = vx >> 7;
+		vx <<= 1;
+		break;
+
+	case OP_9XY0: //9XY0: Skips next instruction if VX != VY
+		pc += vx != vy ? 2 : 0;
+		break;
+
+	case OP_ANNN: //ANNN: Sets I to address NNN
+		I = op.nnn;
+		break;
+
+	case OP_BNNN: //BNNN: Jumps to address NNN + V0, or XNN + VX with QUIRK_JUMP_VX
+		pc = op.nnn + V[(quirks & chip8::QUIRK_JUMP_VX) ? op.x : 0][lane];
+		return true;
+
+	case OP_CXNN: { //CXNN: Sets VX to the result of bitwise AND on a random number (0-255) and NN
+		uint32_t& r = rng[lane];
+		r ^= r << 13;
+		r ^= r >> 17;
+		r ^= r << 5;
+		vx = (r % 255) & op.nn;
+		} break;
+
+	case OP_DXYN: { //DXYN: Draws sprite at coordinate (VX, VY) with width of 8 and height of N pixels
+		unsigned int x = vx & 63;
+		unsigned int y = vy & 31;
+		unsigned int height = op.nn & 0x000F;
+		uint64_t collision = 0;
+
+		for (unsigned int yline = 0; yline < height; ++yline) {
+			if (y + yline >= 32 && !wrap) {
+				break;
+			}
+			uint64_t sprite = (uint64_t)memory[(I + yline) & 0xFFF] << 56;
+			uint64_t line = sprite >> x;
+			if (x > 56 && wrap) {
+				line |= sprite << (64 - x);
+			}
+			uint64_t& row = gfx[lane][(y + yline) & 31];
+			collision |= row & line;
+			row ^= line;
+		}
+		vf = collision != 0;
+		} break;
+
+	case OP_EX9E: //EX9E: Skips next instruction if the key stored in VX is pressed
+		key_read[lane][vx & 0xF] = 1;
+		pc += key[lane][vx & 0xF] == 1 ? 2 : 0;
+		break;
+
+	case OP_EXA1: //EXA1: Skips next instruction if the key stored in VX is not pressed
+		key_read[lane][vx & 0xF] = 1;
+		pc += key[lane][vx & 0xF] == 0 ? 2 : 0;
+		break;
+
+	case OP_FX07: //FX07: Sets VX to the value of the delay timer
+		vx = delay_timer[lane];
+		break;
+
+	case OP_FX0A: { //FX0A: A key press is awaited, then stored in VX
+		int i = 0;
+		while (i <= 0xF && key[lane][i] != 1) {
+			++i;
+		}
+		if (i > 0xF) {
+			state[lane] = LANE_WAIT_KEY;
+			return false;
+		}
+		key_read[lane][i] = 1;
+		vx = i;
+		} break;
+
+	case OP_FX15: //FX15: Sets the delay timer to VX
+		delay_timer[lane] = vx;
+		break;
+
+	case OP_FX18: //FX18: Sets the sound timer to VX
+		sound_timer[lane] = vx;
+		break;
+
+	case OP_FX1E: //FX1E: Adds VX to I (VF not affected)
+		I += vx;
+		break;
+
+	case OP_FX29: //FX29: Sets I to the location of the sprite for the character VX from the fontset
+		I = vx * 5;
+		break;
+
+	case OP_FX33: //FX33: Stores binary-coded decimal of VX at I
+		memory[I & 0xFFF] = vx / 100;
+		memory[(I + 1) & 0xFFF] = (vx / 10) % 10;
+		memory[(I + 2) & 0xFFF] = (vx % 100) % 10;
+		for (int i = 0; i < 3; ++i) {
+			written[(I + i) & 0xFFF] = 1;
+		}
+		break;
+
+	case OP_FX55: //FX55: Stores V0 to VX (Including VX) in memory starting from address I
+		for (int i = 0; i <= op.x; ++i) {
+			memory[(I + i) & 0xFFF] = V[i][lane];
+			written[(I + i) & 0xFFF] = 1;
+		}
+		if (quirks & chip8::QUIRK_LOAD_STORE_I) {
+			I += op.x + 1;
+		}
+		break;
+
+	case OP_FX65: //FX65: Fills V0 to VX (Including VX) with values from memory starting from I
+		for (int i = 0; i <= op.x; ++i) {
+			V[i][lane] = memory[(I + i) & 0xFFF];
+		}
+		if (quirks & chip8::QUIRK_LOAD_STORE_I) {
+			I += op.x + 1;
+		}
+		break;
+
+	default:
+		state[lane] = LANE_INVALID;
+		return false;
+	}
+
+	pc += 2;
+	return true;
+}
\ No newline at end of file
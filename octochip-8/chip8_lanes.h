@@ -0,0 +1,62 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "chip8.h"
+#include "chip8_ops.h"
+
+//Runs many copies of one ROM in lockstep. State is laid out across lanes so one AVX2 register holds a
+//register for every machine, each cycle lanes are grouped by pc and a group runs its opcode under a lane mask.
+//Every quirk profile is modelled, but only the 64x32 CHIP-8 display: SCHIP opcodes stop a lane as unknown, and there are
+//no sound events or idle loop fast-forwarding. Large, so create it with new.
+class chip8_lanes {
+public:
+	static const int LANES = 32; //Machines run together, one per byte of an AVX2 register
+
+	//What a lane is doing
+	enum lane_state {
+		LANE_RUNNING,
+		LANE_WAIT_KEY, //Waiting on FX0A, tried again next frame
+		LANE_INVALID //Hit an unknown opcode, stopped for good
+	};
+
+	chip8_lanes(); //Construct with nothing loaded
+
+	uint64_t gfx[LANES][32]; //Display of every lane, one row per word with x = 0 in the top bit
+	unsigned char key[LANES][16]; //Key inputs of every lane
+	unsigned char key_read[LANES][16]; //Set to 1 when EX9E, EXA1 or FX0A reads a key on a lane, like chip8::key_read
+	unsigned long cycles_run[LANES]; //Cycles each lane completed in the last frame
+
+	bool loadApplication(const char* filename); //Load application from file into every lane
+	bool loadFromBuffer(const uint8_t* data, size_t size); //Load application from memory into every lane, false if it doesn't fit
+	void setQuirks(chip8::quirk_profile quirks); //Quirk profile every lane runs with, loading a ROM keeps it
+	chip8::quirk_profile getQuirks() const { return quirks; } //Quirk profile every lane runs with
+	void seed(int lane, uint32_t seed); //Seed the random numbers CXNN draws on one lane
+	void runFrame(unsigned long cyclesPerFrame); //Emulate one 60hz frame on every lane and tick their timers once
+	lane_state getState(int lane); //What a lane is doing
+	void getRegisters(int lane, unsigned short values[]); //Returns the registers and stack of one lane, laid out like chip8::getRegisters
+	uint64_t getFrameHash(int lane); //FNV-1a hash of one lane's display, equal to chip8::getFrameHash
+
+private:
+	unsigned char V[16][LANES]; //CPU registers, one row per register
+	unsigned short I[LANES]; //Index registers
+	unsigned short pc[LANES]; //Program counters
+	unsigned short opcode[LANES]; //Current opcodes
+	unsigned char delay_timer[LANES]; //Both timers count at 60hz
+	unsigned char sound_timer[LANES];
+	unsigned short stack[LANES][16]; //Stacks
+	unsigned short sp[LANES]; //Stack pointers
+	unsigned char state[LANES]; //lane_state of every lane
+	uint32_t rng[LANES]; //Xorshift state for CXNN
+	unsigned char memory[LANES][4096]; //Memory of every lane
+	chip8_instruction decoded[4096]; //ROM decoded once, shared by every lane
+	unsigned char written[4096]; //Bytes some lane has stored to, lanes may disagree on opcodes there
+	chip8::quirk_profile quirks; //Quirk profile every lane runs with
+
+	void init(); //Initialize data
+	uint32_t step(uint32_t active); //Run one cycle on the active lanes, returns the lanes that stopped
+	uint32_t executeGroup(uint32_t group, const chip8_instruction& op); //Run an opcode on every lane in group, returns the lanes that stopped
+	bool executeLane(int lane, const chip8_instruction& op); //Run an opcode on one lane, false if the lane stopped
+
+	chip8_lanes(const chip8_lanes&);
+	chip8_lanes& operator=(const chip8_lanes&);
+};
\ No newline at end of file
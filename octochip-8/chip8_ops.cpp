@@ -0,0 +1,162 @@
+#include <stdio.h>
+#include <string.h>
+#include "chip8_ops.h"
+
+//Name, description and control flow of every opcode form, indexed like the handler table
+const chip8_op_info OP_INFO[OP_COUNT] = {
+	{ "decode", "Not decoded", 0 },
+	{ "invalid", "Unknown opcode", FLOW_STOP },
+	{ "00CN", "Scrolls the screen down {N} lines (SCHIP)", 0 },
+	{ "00E0", "Clears the screen", 0 },
+	{ "00EE", "Returns from a subroutine", FLOW_RETURN },
+	{ "00FB", "Scrolls the screen right 4 pixels (SCHIP)", 0 },
+	{ "00FC", "Scrolls the screen left 4 pixels (SCHIP)", 0 },
+	{ "00FE", "Switches to the 64x32 low resolution screen (SCHIP)", 0 },
+	{ "00FF", "Switches to the 128x64 high resolution screen (SCHIP)", 0 },
+	{ "1NNN", "Jumps to address 0x{NNN}", FLOW_JUMP },
+	{ "2NNN", "Calls subroutine at 0x{NNN}", FLOW_CALL },
+	{ "3XNN", "Skips next instruction if V{X} == {NN}", FLOW_SKIP },
+	{ "4XNN", "Skips next instruction if V{X} != {NN}", FLOW_SKIP },
+	{ "5XY0", "Skips next instruction if V{X} == V{Y}", FLOW_SKIP },
+	{ "6XNN", "V{X} = {NN}", 0 },
+	{ "7XNN", "V{X} += {NN} (Carry flag not changed)", 0 },
+	{ "8XY0", "V{X} = V{Y}", 0 },
+	{ "8XY1", "V{X} = V{X} | V{Y} (or)", 0 },
+	{ "8XY2", "V{X} = V{X} & V{Y} (and)", 0 },
+	{ "8XY3", "V{X} = V{X} ^ V{Y} (xor)", 0 },
+	{ "8XY4", "V{X} += V{Y} (VF = 1 if there is a carry)", 0 },
+	{ "8XY5", "V{X} -= V{Y} (VF = 1 if there is no borrow)", 0 },
+	{ "8XY6", "Stores LSB of V{X} in VF, shifts V{X} to the right by 1 (Diff implementations)", 0 },
+	{ "8XY7", "V{X} = V{Y} - V{X} (VF = 1 if there is no borrow)", 0 },
+	{ "8XYE", "Stores MSB of V{X} in VF, shifts V{X} to the left by 1 (Diff implementations)", 0 },
+	{ "9XY0", "Skips next instruction if V{X} != V{Y}", FLOW_SKIP },
+	{ "ANNN", "I = {NNN} (Memory location)", 0 },
+	{ "BNNN", "Jumps to address 0x{NNN} + V0", FLOW_JUMP | FLOW_INDIRECT },
+	{ "CXNN", "V{X} = (Random number) & {NN}", 0 },
+	{ "DXYN", "Draw sprite at (V{X}, V{Y}) with a width/height of 8/{N} pixels", 0 },
+	{ "DXY0", "Draw 16x16 sprite at (V{X}, V{Y}) in high resolution (SCHIP)", 0 },
+	{ "EX9E", "Skips next instruction if key stored in V{X} is pressed", FLOW_SKIP },
+	{ "EXA1", "Skips next instruction if key stored in V{X} is not pressed", FLOW_SKIP },
+	{ "FX07", "Sets V{X} to the value of the delay timer", 0 },
+	{ "FX0A", "Halts instruction until a keypress, and stores the key in V{X}", 0 },
+	{ "FX15", "Sets the delay timer to V{X}", 0 },
+	{ "FX18", "Sets the sound timer to V{X}", 0 },
+	{ "FX1E", "I += V{X} (Does not affect VF)", 0 },
+	{ "FX29", "Sets I to the location the sprite for the character in V{X}", 0 },
+	{ "FX30", "Sets I to the location the large sprite for the character in V{X} (SCHIP)", 0 },
+	{ "FX33", "Stores the binary-coded decimal representation of V{X} at I", 0 },
+	{ "FX55", "Stores the values from V0 to V{X} starting at the memory address stored in I", 0 },
+	{ "FX65", "Fills the values from V0 to V{X} starting at the memory address stored in I", 0 },
+	{ "FX75", "Stores the values from V0 to V{X} in the RPL user flags (SCHIP)", 0 },
+	{ "FX85", "Fills the values from V0 to V{X} from the RPL user flags (SCHIP)", 0 }
+};
+
+//Decode an opcode into its handler and fields
+chip8_instruction decodeOpcode(unsigned short opcode) {
+	chip8_instruction op;
+	op.opcode = opcode;
+	op.nnn = opcode & 0x0FFF;
+	op.x = (opcode & 0x0F00) >> 8;
+	op.y = (opcode & 0x00F0) >> 4;
+	op.nn = opcode & 0x00FF;
+	op.handler = OP_INVALID;
+
+	switch (opcode & 0xF000) {
+	case 0x0000:
+		switch (opcode & 0x00FF) {
+		case 0x00E0: op.handler = OP_00E0; break;
+		case 0x00EE: op.handler = OP_00EE; break;
+		case 0x00FB: op.handler = OP_00FB; break;
+		case 0x00FC: op.handler = OP_00FC; break;
+		case 0x00FE: op.handler = OP_00FE; break;
+		case 0x00FF: op.handler = OP_00FF; break;
+		default:
+			if ((opcode & 0x0FF0) == 0x00C0) {
+				op.handler = OP_00CN;
+			}
+		} break; //0NNN: Unnecessary, left invalid
+	case 0x1000: op.handler = OP_1NNN; break;
+	case 0x2000: op.handler = OP_2NNN; break;
+	case 0x3000: op.handler = OP_3XNN; break;
+	case 0x4000: op.handler = OP_4XNN; break;
+	case 0x5000: op.handler = OP_5XY0; break;
+	case 0x6000: op.handler = OP_6XNN; break;
+	case 0x7000: op.handler = OP_7XNN; break;
+	case 0x8000:
+		switch (opcode & 0x000F) {
+		case 0x0000: op.handler = OP_8XY0; break;
+		case 0x0001: op.handler = OP_8XY1; break;
+		case 0x0002: op.handler = OP_8XY2; break;
+		case 0x0003: op.handler = OP_8XY3; break;
+		case 0x0004: op.handler = OP_8XY4; break;
+		case 0x0005: op.handler = OP_8XY5; break;
+		case 0x0006: op.handler = OP_8XY6; break;
+		case 0x0007: op.handler = OP_8XY7; break;
+		case 0x000E: op.handler = OP_8XYE; break;
+		} break;
+	case 0x9000: op.handler = OP_9XY0; break;
+	case 0xA000: op.handler = OP_ANNN; break;
+	case 0xB000: op.handler = OP_BNNN; break;
+	case 0xC000: op.handler = OP_CXNN; break;
+	case 0xD000: op.handler = (opcode & 0x000F) == 0 ? OP_DXY0 : OP_DXYN; break;
+	case 0xE000:
+		switch (opcode & 0x00FF) {
+		case 0x009E: op.handler = OP_EX9E; break;
+		case 0x00A1: op.handler = OP_EXA1; break;
+		} break;
+	case 0xF000:
+		switch (opcode & 0x00FF) {
+		case 0x0007: op.handler = OP_FX07; break;
+		case 0x000A: op.handler = OP_FX0A; break;
+		case 0x0015: op.handler = OP_FX15; break;
+		case 0x0018: op.handler = OP_FX18; break;
+		case 0x001E: op.handler = OP_FX1E; break;
+		case 0x0029: op.handler = OP_FX29; break;
+		case 0x0030: op.handler = OP_FX30; break;
+		case 0x0033: op.handler = OP_FX33; break;
+		case 0x0055: op.handler = OP_FX55; break;
+		case 0x0065: op.handler = OP_FX65; break;
+		case 0x0075: op.handler = OP_FX75; break;
+		case 0x0085: op.handler = OP_FX85; break;
+		} break;
+	}
+	return op;
+}
+
+//Describe a decoded opcode into out, returns the length written like snprintf
+int formatOpcode(char* out, size_t size, const chip8_instruction& op) {
+	const char* text = OP_INFO[op.handler].text;
+	size_t length = 0;
+	char field[8];
+	while (*text != '\0') {
+		const char* value = NULL;
+		if (strncmp(text, "{NNN}", 5) == 0) {
+			snprintf(field, sizeof(field), "%03X", op.nnn);
+			text += 5;
+		} else if (strncmp(text, "{NN}", 4) == 0) {
+			snprintf(field, sizeof(field), "%02X", op.nn);
+			text += 4;
+		} else if (strncmp(text, "{N}", 3) == 0) {
+			snprintf(field, sizeof(field), "%X", op.nn & 0xF);
+			text += 3;
+		} else if (strncmp(text, "{X}", 3) == 0) {
+			snprintf(field, sizeof(field), "%X", op.x);
+			text += 3;
+		} else if (strncmp(text, "{Y}", 3) == 0) {
+			snprintf(field, sizeof(field), "%X", op.y);
+			text += 3;
+		} else {
+			field[0] = *text++;
+			field[1] = '\0';
+		}
+		for (value = field; *value != '\0'; ++value, ++length) {
+			if (length + 1 < size) {
+				out[length] = *value;
+			}
+		}
+	}
+	if (size > 0) {
+		out[length < size ? length : size - 1] = '\0';
+	}
+	return (int)length;
+}
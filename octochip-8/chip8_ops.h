@@ -0,0 +1,45 @@
+#pragma once
+#include <stddef.h>
+
+//Handler table indices, one per opcode form
+enum {
+	OP_DECODE, //Not decoded yet
+	OP_INVALID,
+	OP_00CN, OP_00E0, OP_00EE, OP_00FB, OP_00FC, OP_00FE, OP_00FF, OP_1NNN, OP_2NNN, OP_3XNN, OP_4XNN, OP_5XY0, OP_6XNN, OP_7XNN,
+	OP_8XY0, OP_8XY1, OP_8XY2, OP_8XY3, OP_8XY4, OP_8XY5, OP_8XY6, OP_8XY7, OP_8XYE,
+	OP_9XY0, OP_ANNN, OP_BNNN, OP_CXNN, OP_DXYN, OP_DXY0, OP_EX9E, OP_EXA1,
+	OP_FX07, OP_FX0A, OP_FX15, OP_FX18, OP_FX1E, OP_FX29, OP_FX30, OP_FX33, OP_FX55, OP_FX65, OP_FX75, OP_FX85,
+	OP_COUNT
+};
+
+//Opcode decoded once into its handler and operand fields
+struct chip8_instruction {
+	unsigned short opcode; //Raw opcode
+	unsigned short nnn; //Address operand
+	unsigned char handler; //Index into the handler table, 0 until decoded
+	unsigned char x; //Register X
+	unsigned char y; //Register Y
+	unsigned char nn; //Byte operand, N is the low nibble
+};
+
+//How an opcode form changes control flow
+enum {
+	FLOW_JUMP = 1, //Continues at its target, 1NNN and BNNN
+	FLOW_CALL = 2, //Continues at its target and comes back after it, 2NNN
+	FLOW_RETURN = 4, //Continues after the last call, 00EE
+	FLOW_SKIP = 8, //Continues at the next opcode or the one after it
+	FLOW_INDIRECT = 16, //Target depends on a register, BNNN
+	FLOW_STOP = 32 //Stops the machine, unknown opcodes
+};
+
+//Name, description and control flow of one opcode form
+struct chip8_op_info {
+	const char* name; //Opcode form, like "DXYN"
+	const char* text; //Description, {X} {Y} {N} {NN} and {NNN} stand for the operands
+	unsigned char flow; //FLOW_ flags, 0 if it always continues at the next opcode
+};
+
+extern const chip8_op_info OP_INFO[OP_COUNT]; //Every opcode form, indexed like the handler table
+
+chip8_instruction decodeOpcode(unsigned short opcode); //Decode an opcode into its handler and fields
+int formatOpcode(char* out, size_t size, const chip8_instruction& op); //Describe a decoded opcode into out, returns the length written like snprintf
\ No newline at end of file
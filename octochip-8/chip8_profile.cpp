@@ -0,0 +1,99 @@
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "chip8_profile.h"
+
+const int REPORT_LOOPS = 20; //Hot loops listed in the report
+
+//Empty profile
+chip8_profile::chip8_profile() {
+	clear();
+}
+
+//Forget everything counted
+void chip8_profile::clear() {
+	memset(counts, 0, sizeof(counts));
+	memset(opcodes, 0, sizeof(opcodes));
+	memset(ops, 0, sizeof(ops));
+	memset(timed, 0, sizeof(timed));
+	memset(nanoseconds, 0, sizeof(nanoseconds));
+	loops.clear();
+}
+
+//Start timing an opcode
+uint64_t chip8_profile::start() {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//Stop timing an opcode started at start
+void chip8_profile::stop(unsigned char handler, uint64_t started) {
+	++timed[handler];
+	nanoseconds[handler] += start() - started;
+}
+
+//Write the report, false if the file can't be written
+bool chip8_profile::writeReport(const char* filename) {
+	#pragma warning(suppress : 4996)
+	FILE* file = fopen(filename, "w");
+	if (file == NULL) {
+		return false;
+	}
+	writeReport(file);
+	return fclose(file) == 0;
+}
+
+//Write the histogram, hot loops, opcode times and a per-address listing lined up with the disassembler's
+void chip8_profile::writeReport(FILE* file) {
+	unsigned long long total = 0;
+	for (int i = 0; i < OP_COUNT; ++i) {
+		total += ops[i];
+	}
+	double percent = total > 0 ? 100.0 / total : 0.0;
+	fprintf(file, "Instructions: %llu\n", total);
+
+	//Opcode forms, most executed first
+	std::vector<int> order;
+	for (int i = 0; i < OP_COUNT; ++i) {
+		if (ops[i] > 0) {
+			order.push_back(i);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return ops[a] > ops[b]; });
+	fprintf(file, "\nOpcodes:\n");
+	for (size_t i = 0; i < order.size(); ++i) {
+		fprintf(file, "%-8s %12llu %6.2f%%\n", OP_INFO[order[i]].name, ops[order[i]], ops[order[i]] * percent);
+	}
+
+	//Backward jumps, with the instructions executed between the target and the jump
+	std::vector<std::pair<unsigned long long, std::pair<unsigned short, unsigned short> > > hot;
+	for (std::map<std::pair<unsigned short, unsigned short>, unsigned long long>::const_iterator it = loops.begin(); it != loops.end(); ++it) {
+		hot.push_back(std::make_pair(it->second, it->first));
+	}
+	std::stable_sort(hot.begin(), hot.end(), [](const std::pair<unsigned long long, std::pair<unsigned short, unsigned short> >& a,
+		const std::pair<unsigned long long, std::pair<unsigned short, unsigned short> >& b) { return a.first > b.first; });
+	fprintf(file, "\nHot loops (jump -> target, times taken, instructions in range):\n");
+	for (size_t i = 0; i < hot.size() && i < (size_t)REPORT_LOOPS; ++i) {
+		unsigned long long body = 0;
+		for (unsigned short pc = hot[i].second.second; pc <= hot[i].second.first; ++pc) {
+			body += counts[pc];
+		}
+		fprintf(file, "0x%03X -> 0x%03X %12llu %12llu %6.2f%%\n", hot[i].second.first, hot[i].second.second, hot[i].first, body, body * percent);
+	}
+
+	//Timed opcodes
+	fprintf(file, "\nTimed opcodes (calls, total ms, ns per call):\n");
+	const int timed_ops[4] = { OP_DXYN, OP_00E0, OP_FX55, OP_FX65 };
+	for (int i = 0; i < 4; ++i) {
+		int op = timed_ops[i];
+		fprintf(file, "%-8s %12llu %12.3f %10.1f\n", OP_INFO[op].name, timed[op], nanoseconds[op] / 1e6, timed[op] > 0 ? (double)nanoseconds[op] / timed[op] : 0.0);
+	}
+
+	//Every executed address, in the disassembler's "0xADR    OPCD    " layout so the two can be joined on address
+	fprintf(file, "\nAddresses:\n");
+	for (int pc = 0; pc < 4096; ++pc) {
+		if (counts[pc] > 0) {
+			fprintf(file, "0x%03X    %04X    %12llu %6.2f%%\n", pc, opcodes[pc], counts[pc], counts[pc] * percent);
+		}
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <map>
+#include <utility>
+#include "chip8_ops.h"
+
+//Profile policy for an interpreter run that records nothing. Every call is empty, so the production interpreter compiles to the same code as without hooks.
+struct chip8_no_profile {
+	static const bool FAST_FORWARD = true; //Idle loops are skipped to the end of the run
+	void instruction(unsigned short, const chip8_instruction&) {} //About to execute op at pc
+	void jump(unsigned short, unsigned short) {} //1NNN or BNNN jumped from pc to target
+	uint64_t start() { return 0; } //Start timing an opcode
+	void stop(unsigned char, uint64_t) {} //Stop timing an opcode started at start
+};
+
+//Profile policy that counts executions per program counter and per opcode, finds hot loops from backward jumps,
+//and times DXYN, 00E0, FX55 and FX65. Attach it with chip8::setProfile.
+class chip8_profile {
+public:
+	static const bool FAST_FORWARD = false; //Idle loops run instruction by instruction so every one is counted
+
+	chip8_profile(); //Empty profile
+
+	void clear(); //Forget everything counted
+	bool writeReport(const char* filename); //Write the report, false if the file can't be written
+	void writeReport(FILE* file); //Write the histogram, hot loops, opcode times and a per-address listing lined up with the disassembler's
+
+	unsigned long long executed(unsigned short pc) const { return counts[pc & 0xFFF]; } //Executions of the opcode at pc
+	unsigned long long executedOps(unsigned char handler) const { return ops[handler]; } //Executions of one opcode form
+
+	void instruction(unsigned short pc, const chip8_instruction& op) { //About to execute op at pc
+		++counts[pc & 0xFFF];
+		opcodes[pc & 0xFFF] = op.opcode;
+		++ops[op.handler];
+	}
+	void jump(unsigned short pc, unsigned short target) { //1NNN or BNNN jumped from pc to target
+		if (target <= pc) {
+			++loops[std::make_pair(pc & 0xFFF, target & 0xFFF)];
+		}
+	}
+	uint64_t start(); //Start timing an opcode
+	void stop(unsigned char handler, uint64_t started); //Stop timing an opcode started at start
+
+private:
+	unsigned long long counts[4096]; //Executions per address
+	unsigned short opcodes[4096]; //Last opcode executed at each address
+	unsigned long long ops[OP_COUNT]; //Executions per opcode form
+	unsigned long long timed[OP_COUNT]; //Timed executions per opcode form
+	uint64_t nanoseconds[OP_COUNT]; //Time spent per timed opcode form
+	std::map<std::pair<unsigned short, unsigned short>, unsigned long long> loops; //Backward jumps (from, to) and how often they were taken
+};
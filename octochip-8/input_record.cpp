@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <algorithm>
+#include "input_record.h"
+
+//Empty recording
+input_record::input_record() {
+	clear(1, 0);
+}
+
+//Start a new recording
+void input_record::clear(uint32_t seed, int speed) {
+	this->seed = seed;
+	this->speed = speed;
+	events.clear();
+	keys = 0;
+	next = 0;
+}
+
+//Log every key that changed since the last call, bit n is key n
+void input_record::record(unsigned long long cycle, unsigned short keys) {
+	unsigned short changed = this->keys ^ keys;
+	for (int i = 0; changed != 0; ++i, changed >>= 1) {
+		if (changed & 1) {
+			key_event e = { cycle, i, (keys >> i) & 1 };
+			events.push_back(e);
+		}
+	}
+	this->keys = keys;
+}
+
+//Replay from the start
+void input_record::rewind() {
+	keys = 0;
+	next = 0;
+}
+
+//Key state with every change up to cycle applied, bit n is key n
+unsigned short input_record::replay(unsigned long long cycle) {
+	while (next < events.size() && events[next].cycle <= cycle) {
+		const key_event& e = events[next];
+		if (e.state) {
+			keys |= (unsigned short)(1 << e.key);
+		} else {
+			keys &= (unsigned short)~(1 << e.key);
+		}
+		++next;
+	}
+	return keys;
+}
+
+//True once every change has been replayed
+bool input_record::finished() {
+	return next == events.size();
+}
+
+//Read a recording sorted by cycle, false if it can't be opened
+bool input_record::load(const char* path) {
+	#pragma warning(suppress : 4996)
+	FILE* file = fopen(path, "r");
+	if (file == NULL) {
+		return false;
+	}
+	clear(seed, speed); //The seed, speed and quirks set before loading stay unless the file has its own
+	key_event e;
+	unsigned int value = 0;
+	char line[256];
+	char name[32];
+	while (fgets(line, sizeof(line), file) != NULL) {
+		if (line[0] == '#') {
+			continue;
+		}
+		#pragma warning(suppress : 4996)
+		if (sscanf(line, "seed %x", &value) == 1) {
+			seed = value;
+			continue;
+		}
+		#pragma warning(suppress : 4996)
+		if (sscanf(line, "speed %u", &value) == 1) {
+			speed = (int)value;
+			continue;
+		}
+		#pragma warning(suppress : 4996)
+		if (sscanf(line, "quirks %31s", name) == 1) {
+			quirks = name;
+			continue;
+		}
+		#pragma warning(suppress : 4996)
+		if (sscanf(line, "%llu %x %d", &e.cycle, &e.key, &e.state) == 3 && e.key >= 0 && e.key <= 0xF) {
+			e.state = e.state != 0;
+			events.push_back(e);
+		}
+	}
+	fclose(file);
+	std::stable_sort(events.begin(), events.end(), [](const key_event& a, const key_event& b) { return a.cycle < b.cycle; });
+	return true;
+}
+
+//Write the recording, false if it can't be written
+bool input_record::save(const char* path) {
+	#pragma warning(suppress : 4996)
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		return false;
+	}
+	fprintf(file, "# OctoChip-8 input recording\nseed %08x\n", (unsigned int)seed);
+	if (speed > 0) {
+		fprintf(file, "speed %i\n", speed);
+	}
+	if (!quirks.empty()) {
+		fprintf(file, "quirks %s\n", quirks.c_str());
+	}
+	for (size_t i = 0; i < events.size(); ++i) {
+		fprintf(file, "%llu %X %i\n", events[i].cycle, events[i].key, events[i].state);
+	}
+	return fclose(file) == 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+//A key change at an emulated cycle
+struct key_event {
+	unsigned long long cycle; //Emulated cycle the change applies at
+	int key; //Chip-8 key
+	int state; //1 down, 0 up
+};
+
+//Key changes logged against emulated cycles, with the seed, speed and quirks a run needs to be repeated exactly.
+//Emulated cycles count every frame's full budget, including cycles spent waiting on FX0A, so frames line up on replay.
+//Files hold "seed <hex>", "speed <cycles/s>" and "quirks <profile name>" lines and one "<cycle> <key in hex> <1 down | 0 up>"
+//line per change, # starts a comment.
+class input_record {
+public:
+	uint32_t seed; //CXNN seed the run started from
+	int speed; //Cycles per second the run used, 0 if not known
+	std::string quirks; //Name of the quirk profile the run used, empty if not known
+	std::vector<key_event> events; //Key changes sorted by cycle
+
+	input_record(); //Empty recording
+
+	void clear(uint32_t seed, int speed); //Start a new recording
+	void record(unsigned long long cycle, unsigned short keys); //Log every key that changed since the last call, bit n is key n
+	void rewind(); //Replay from the start
+	unsigned short replay(unsigned long long cycle); //Key state with every change up to cycle applied, bit n is key n
+	bool finished(); //True once every change has been replayed
+	bool load(const char* path); //Read a recording, keeping the current seed, speed and quirks unless it has its own. False if it can't be opened
+	bool save(const char* path); //Write the recording, false if it can't be written
+
+private:
+	unsigned short keys; //Key state after the changes recorded or replayed so far
+	size_t next; //Next change to replay
+};
@@ -1,10 +1,22 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <string>
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <time.h>
+#include <vector>
 #include "chip8.h"
+#include "chip8_profile.h"
+#include "audio.h"
+#include "bitmap_font.h"
+#include "input_record.h"
+#include "sample_ring.h"
+#include "triple_buffer.h"
 
 //Texture wrapper class. This comes from Lazy Foo' Productions (http://lazyfoo.net/)
 class LTexture {
@@ -13,7 +25,6 @@ public:
 	~LTexture(); //Deallocate memory
 
 	bool loadFromFile(std::string path); //Loads image
-	bool loadFromRenderedText(std::string textureText, SDL_Color textColor); //Creates image from font string
 	void free(); //Deallocates texture
 	void setColor(Uint8 red, Uint8 green, Uint8 blue); //Sets color modulation
 	void setBlendMode(SDL_BlendMode blending); //Set blending
@@ -29,25 +40,85 @@ private:
 	int mHeight;
 };
 
+//Monospace text grid drawn from a glyph atlas in one batch. The atlas is built once, from the embedded bitmap
+//font or optionally a TTF font, and a cell's quad is only rebuilt when its character changes.
+class LTextGrid {
+public:
+	LTextGrid(); //Initialize variables
+	~LTextGrid(); //Deallocate memory
+
+	bool loadAtlas(const char* fontPath); //Builds the atlas from a TTF font, or the embedded font if fontPath is NULL or fails
+	void setLayout(int x, int y, int columns, int rows, int rowHeight); //Places an empty grid with its top left cell at x, y
+	void print(int column, int row, const char* text); //Writes text into the grid, clipped at the end of the row
+	void render(SDL_Color color); //Draws every cell in one batch
+	void free(); //Deallocates the atlas
+
+private:
+	SDL_Texture* mAtlas;
+	int mCellWidth; //Glyph cell size in the atlas
+	int mCellHeight;
+	int mScale; //Screen pixels per atlas pixel
+	int mColumns;
+	std::vector<char> mText; //Character in every cell
+	std::vector<SDL_Vertex> mVertices; //Four corners per cell
+	std::vector<int> mIndices; //Two triangles per cell
+
+	void setCell(int cell, char c); //Points a cell's quad at the glyph for c
+};
+
+//Paces a loop at 60 frames a second by sleeping until each frame is due. Deadlines are counted
+//from a fixed start so sleeping late doesn't add up, and the frames owed are returned so they can be run in a batch.
+class LFramePacer {
+public:
+	LFramePacer(); //Start pacing from now
+
+	void reset(); //Start pacing from now, forgetting any frames owed
+	int wait(); //Sleeps until the next frame is due, returns the frames owed since the last call
+
+private:
+	Uint64 mFrequency; //Performance counter ticks per second
+	Uint64 mStart; //Performance counter at frame 0
+	Uint64 mFrame; //Frames handed out since mStart
+
+	Uint64 framesElapsed(Uint64 now); //Frames due by now since mStart
+};
+
 //Declare graphics variables
 const int SCREEN_WIDTH = 512; //formerly 1024
 const int SCREEN_HEIGHT = 426; //formerly 512
 const int SCREEN_HEIGHT_SMALL = 256;
-const int MODIFIER = 8;
+const int DISPLAY_WIDTH = chip8::MAX_WIDTH; //Largest chip8 display size in pixels, the low resolution uses the top left of the texture
+const int DISPLAY_HEIGHT = chip8::MAX_HEIGHT;
 const unsigned char TRANS_COLORS[3] = { 54, 57, 63 }; //RGB of the color to treat as transparent when loading images
-const char* FONT_PATH = "C:/Windows/Fonts/consola.ttf";
-const int FONT_SIZE = 18;
+const int FONT_SIZE = 18; //Point size used for --font
+const int ATLAS_COLUMNS = 16; //Glyphs per row of the atlas
+const int BITMAP_FONT_SCALE = 2; //Screen pixels per embedded font pixel
+const int FRAME_RATE = 60; //Frames per second, the timers count down once per frame
+const int MAX_CATCH_UP = 6; //Frames run in one batch before the pacer gives up on catching up
+const int AUDIO_RATE = 44100; //Samples per second
+const int AUDIO_FRAME = AUDIO_RATE / FRAME_RATE; //Samples rendered per emulated frame
+const int AUDIO_BUFFER = 256; //Samples the device asks for at a time, small so the buzzer starts within a few milliseconds
+const int AUDIO_MAX_QUEUED = 2 * AUDIO_FRAME; //Samples queued past which frames are dropped, so the buzzer never lags far behind the display
+const int TONE_FREQUENCY = 440; //Pitch of the buzzer in Hz
+const int16_t TONE_AMPLITUDE = 3000;
 
 SDL_Window* window = NULL;
 SDL_Renderer* renderer = NULL;
-TTF_Font* font;
-LTexture textTexture;
+LTextGrid textGrid; //Instructions screen, then the register panel
+const char* fontPath = NULL; //TTF font to build the glyph atlas from, set with --font
+SDL_Texture* displayTexture = NULL; //Streaming texture the chip8 display is expanded into
+SDL_AudioDeviceID audioDevice = 0; //Device playing the buzzer, 0 if there's no sound
+sample_ring<int16_t, 4096> audioSamples; //Samples from the emulation thread waiting for the audio callback
+wav_writer wav; //File the buzzer is also written to, set with --wav
+const char* wavPath = NULL;
+Uint32 pixelOn = 0xFFFFFFFF; //ARGB colour of lit pixels, set with --on
+Uint32 pixelOff = 0xFF000000; //ARGB colour of unlit pixels, set with --off
 
-const SDL_Color BLACK = { 0, 0, 0 };
-const SDL_Color WHITE = { 255, 255, 255 };
-const SDL_Color RED = { 255, 0, 0 };
-const SDL_Color GREEN = { 0, 255, 0 };
-const SDL_Color BLUE = { 0, 0, 255 };
+const SDL_Color BLACK = { 0, 0, 0, 255 };
+const SDL_Color WHITE = { 255, 255, 255, 255 };
+const SDL_Color RED = { 255, 0, 0, 255 };
+const SDL_Color GREEN = { 0, 255, 0, 255 };
+const SDL_Color BLUE = { 0, 0, 255, 255 };
 
 //Initialize Display
 bool init_SDL() {
@@ -70,20 +141,23 @@ bool init_SDL() {
 				//Initialize renderer color
 				SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
 
+				//Create the display texture, scaled up with nearest pixel sampling
+				SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
+				displayTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+				if (displayTexture == NULL) {
+					printf("Display texture could not be created! SDL Error: %s\n", SDL_GetError());
+					return false;
+				}
+
 				//Initialize PNG loading
 				int imgFlags = IMG_INIT_PNG;
 				if (!(IMG_Init(imgFlags) & imgFlags)) {
 					printf("SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
 				}
 
-				//Initialize SDL_ttf
+				//Initialize SDL_ttf, only needed for --font
 				if (TTF_Init() == -1) {
 					printf("SDL_ttf could not initialize! SDL_ttf Error: %s\n", TTF_GetError());
-				} else {
-					font = TTF_OpenFont(FONT_PATH, FONT_SIZE);
-					if (font == NULL) {
-						printf("Failed to load font! SDL_ttf Error: %s\n", TTF_GetError());
-					}
 				}
 			}
 		}
@@ -91,10 +165,45 @@ bool init_SDL() {
 	return true;
 }
 
+//Audio callback, plays the samples the emulation thread queued and silence once they run out
+void playSamples(void*, Uint8* stream, int length) {
+	int16_t* out = (int16_t*)stream;
+	size_t count = length / sizeof(int16_t);
+	size_t got = audioSamples.read(out, count);
+	memset(out + got, 0, (count - got) * sizeof(int16_t));
+}
+
+//Open the audio device, running without sound if there isn't one
+void init_audio() {
+	if (SDL_InitSubSystem(SDL_INIT_AUDIO) < 0) {
+		printf("SDL audio could not initialize, running without sound! SDL_Error: %s\n", SDL_GetError());
+		return;
+	}
+	SDL_AudioSpec want;
+	SDL_AudioSpec have;
+	memset(&want, 0, sizeof(want));
+	want.freq = AUDIO_RATE;
+	want.format = AUDIO_S16SYS;
+	want.channels = 1;
+	want.samples = AUDIO_BUFFER;
+	want.callback = playSamples;
+	audioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+	if (audioDevice == 0) {
+		printf("Audio device could not be opened, running without sound! SDL_Error: %s\n", SDL_GetError());
+		return;
+	}
+	SDL_PauseAudioDevice(audioDevice, 0);
+}
+
 //Close SDL
 void close_SDL() {
-	TTF_CloseFont(font);
-	font = NULL;
+	if (audioDevice != 0) {
+		SDL_CloseAudioDevice(audioDevice);
+		audioDevice = 0;
+	}
+	textGrid.free();
+	SDL_DestroyTexture(displayTexture);
+	displayTexture = NULL;
 	SDL_DestroyRenderer(renderer);
 	renderer = NULL;
 	SDL_DestroyWindow(window);
@@ -142,25 +251,6 @@ bool LTexture::loadFromFile(std::string path) {
 	return mTexture != NULL;
 }
 
-//Creates image from font string
-bool LTexture::loadFromRenderedText(std::string textureText, SDL_Color textColor) {
-	free();
-	SDL_Surface* textSurface = TTF_RenderText_Solid(font, textureText.c_str(), textColor);
-	if (textSurface == NULL) {
-		printf("Unable to render text surface! SDL_ttf Error: %s\n", TTF_GetError());
-	} else {
-		mTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-		if (mTexture == NULL) {
-			printf("Unable to create texture from rendered text! SDL Error %s\n", SDL_GetError());
-		} else {
-			mWidth = textSurface->w;
-			mHeight = textSurface->h;
-		}
-		SDL_FreeSurface(textSurface);
-	}
-	return mTexture != NULL;
-}
-
 //Deallocates texture
 void LTexture::free() {
 	if (mTexture != NULL) {
@@ -208,31 +298,430 @@ int LTexture::getHeight() {
 	return mHeight;
 }
 
+//Initialize LTextGrid
+LTextGrid::LTextGrid() {
+	mAtlas = NULL;
+	mCellWidth = 0;
+	mCellHeight = 0;
+	mScale = 1;
+	mColumns = 0;
+}
+
+//Deallocates LTextGrid
+LTextGrid::~LTextGrid() {
+	free();
+}
+
+//Builds the glyph atlas, white glyphs on a transparent background so render can colour them
+bool LTextGrid::loadAtlas(const char* fontPath) {
+	free();
+	TTF_Font* font = NULL;
+	if (fontPath != NULL) {
+		font = TTF_OpenFont(fontPath, FONT_SIZE);
+		if (font == NULL) {
+			printf("Failed to load font, using the built in one! SDL_ttf Error: %s\n", TTF_GetError());
+		}
+	}
+
+	int advance = 0;
+	if (font != NULL && TTF_GlyphMetrics(font, 'M', NULL, NULL, NULL, NULL, &advance) == 0) {
+		mCellWidth = advance;
+		mCellHeight = TTF_FontHeight(font);
+		mScale = 1;
+	} else {
+		mCellWidth = BITMAP_FONT_WIDTH + 1;
+		mCellHeight = BITMAP_FONT_HEIGHT + 1;
+		mScale = BITMAP_FONT_SCALE;
+	}
+
+	int atlasRows = (BITMAP_FONT_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS;
+	SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_COLUMNS * mCellWidth, atlasRows * mCellHeight, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (atlas == NULL) {
+		printf("Unable to create glyph atlas! SDL Error: %s\n", SDL_GetError());
+		TTF_CloseFont(font);
+		return false;
+	}
+	SDL_FillRect(atlas, NULL, 0x00FFFFFF);
+
+	SDL_Color white = { 255, 255, 255, 255 };
+	for (int i = 0; i < BITMAP_FONT_COUNT; ++i) {
+		int cellX = (i % ATLAS_COLUMNS) * mCellWidth;
+		int cellY = (i / ATLAS_COLUMNS) * mCellHeight;
+		if (font != NULL) {
+			SDL_Surface* glyph = TTF_RenderGlyph_Blended(font, (Uint16)(BITMAP_FONT_FIRST + i), white);
+			if (glyph != NULL) {
+				SDL_Rect cell = { cellX, cellY, mCellWidth, mCellHeight };
+				SDL_SetSurfaceBlendMode(glyph, SDL_BLENDMODE_NONE);
+				SDL_BlitSurface(glyph, NULL, atlas, &cell);
+				SDL_FreeSurface(glyph);
+			}
+		} else {
+			for (int y = 0; y < BITMAP_FONT_HEIGHT; ++y) {
+				Uint32* row = (Uint32*)((Uint8*)atlas->pixels + (cellY + y) * atlas->pitch) + cellX;
+				for (int x = 0; x < BITMAP_FONT_WIDTH; ++x) {
+					if (BITMAP_FONT[i][y] & (0x80 >> x)) {
+						row[x] = 0xFFFFFFFF;
+					}
+				}
+			}
+		}
+	}
+	TTF_CloseFont(font);
+
+	mAtlas = SDL_CreateTextureFromSurface(renderer, atlas);
+	SDL_FreeSurface(atlas);
+	if (mAtlas == NULL) {
+		printf("Unable to create texture from glyph atlas! SDL Error: %s\n", SDL_GetError());
+		return false;
+	}
+	SDL_SetTextureBlendMode(mAtlas, SDL_BLENDMODE_BLEND);
+	return true;
+}
+
+//Places an empty grid with its top left cell at x, y
+void LTextGrid::setLayout(int x, int y, int columns, int rows, int rowHeight) {
+	mColumns = columns;
+	mText.assign(columns * rows, ' ');
+	mVertices.resize(columns * rows * 4);
+	mIndices.resize(columns * rows * 6);
+
+	SDL_Color unset = { 0, 0, 0, 0 };
+	float width = (float)(mCellWidth * mScale);
+	float height = (float)(mCellHeight * mScale);
+	for (int cell = 0; cell < columns * rows; ++cell) {
+		float left = (float)(x + (cell % columns) * mCellWidth * mScale);
+		float top = (float)(y + (cell / columns) * rowHeight);
+		SDL_Vertex* corners = &mVertices[cell * 4];
+		corners[0].position.x = left;         corners[0].position.y = top;
+		corners[1].position.x = left + width; corners[1].position.y = top;
+		corners[2].position.x = left;         corners[2].position.y = top + height;
+		corners[3].position.x = left + width; corners[3].position.y = top + height;
+		for (int i = 0; i < 4; ++i) {
+			corners[i].color = unset;
+		}
+
+		static const int QUAD[6] = { 0, 1, 2, 2, 1, 3 };
+		for (int i = 0; i < 6; ++i) {
+			mIndices[cell * 6 + i] = cell * 4 + QUAD[i];
+		}
+		setCell(cell, ' ');
+	}
+}
+
+//Writes text into the grid, only cells whose character changes are touched
+void LTextGrid::print(int column, int row, const char* text) {
+	for (int x = column; *text != '\0' && x < mColumns; ++x, ++text) {
+		int cell = row * mColumns + x;
+		if (mText[cell] != *text) {
+			mText[cell] = *text;
+			setCell(cell, *text);
+		}
+	}
+}
+
+//Points a cell's quad at the glyph for c
+void LTextGrid::setCell(int cell, char c) {
+	int glyph = (unsigned char)c - BITMAP_FONT_FIRST;
+	if (glyph < 0 || glyph >= BITMAP_FONT_COUNT) {
+		glyph = '?' - BITMAP_FONT_FIRST;
+	}
+	float atlasWidth = (float)(ATLAS_COLUMNS * mCellWidth);
+	float atlasHeight = (float)(((BITMAP_FONT_COUNT + ATLAS_COLUMNS - 1) / ATLAS_COLUMNS) * mCellHeight);
+	float left = (glyph % ATLAS_COLUMNS) * mCellWidth / atlasWidth;
+	float top = (glyph / ATLAS_COLUMNS) * mCellHeight / atlasHeight;
+	float right = left + mCellWidth / atlasWidth;
+	float bottom = top + mCellHeight / atlasHeight;
+
+	SDL_Vertex* corners = &mVertices[cell * 4];
+	corners[0].tex_coord.x = left;  corners[0].tex_coord.y = top;
+	corners[1].tex_coord.x = right; corners[1].tex_coord.y = top;
+	corners[2].tex_coord.x = left;  corners[2].tex_coord.y = bottom;
+	corners[3].tex_coord.x = right; corners[3].tex_coord.y = bottom;
+}
+
+//Draws every cell in one batch
+void LTextGrid::render(SDL_Color color) {
+	if (mAtlas == NULL || mVertices.empty()) {
+		return;
+	}
+	if (memcmp(&mVertices[0].color, &color, sizeof(color)) != 0) {
+		for (size_t i = 0; i < mVertices.size(); ++i) {
+			mVertices[i].color = color;
+		}
+	}
+	SDL_RenderGeometry(renderer, mAtlas, &mVertices[0], (int)mVertices.size(), &mIndices[0], (int)mIndices.size());
+}
+
+//Deallocates the atlas
+void LTextGrid::free() {
+	if (mAtlas != NULL) {
+		SDL_DestroyTexture(mAtlas);
+		mAtlas = NULL;
+	}
+}
+
+//Initialize LFramePacer
+LFramePacer::LFramePacer() {
+	mFrequency = SDL_GetPerformanceFrequency();
+	reset();
+}
+
+//Start pacing from now
+void LFramePacer::reset() {
+	mStart = SDL_GetPerformanceCounter();
+	mFrame = 0;
+}
+
+//Frames due by now since mStart
+Uint64 LFramePacer::framesElapsed(Uint64 now) {
+	return (now - mStart) * FRAME_RATE / mFrequency;
+}
+
+//Sleep for ticks of the performance counter without spinning
+static void sleepTicks(Uint64 ticks, Uint64 frequency) {
+#if defined(_WIN32)
+	//Round up, oversleeping is made up by the next frame's deadline
+	SDL_Delay((Uint32)((ticks * 1000 + frequency - 1) / frequency));
+#else
+	Uint64 ns = ticks * 1000000000ULL / frequency;
+	struct timespec remaining = { (time_t)(ns / 1000000000ULL), (long)(ns % 1000000000ULL) };
+	while (clock_nanosleep(CLOCK_MONOTONIC, 0, &remaining, &remaining) != 0) continue; //Resume after signals
+#endif
+}
+
+//Sleeps until the next frame is due, returns the frames owed since the last call
+int LFramePacer::wait() {
+	Uint64 now = SDL_GetPerformanceCounter();
+	while (framesElapsed(now) <= mFrame) {
+		//Frame n is due at mStart + n / FRAME_RATE seconds, rounded up to a whole tick
+		Uint64 due = mStart + ((mFrame + 1) * mFrequency + FRAME_RATE - 1) / FRAME_RATE;
+		sleepTicks(due - now, mFrequency);
+		now = SDL_GetPerformanceCounter();
+	}
+
+	//Stalls like dragging the window would make the next batch huge, start over instead
+	Uint64 owed = framesElapsed(now) - mFrame;
+	if (owed > MAX_CATCH_UP) {
+		mStart = now;
+		mFrame = 0;
+		return 1;
+	}
+	mFrame += owed;
+	return (int)owed;
+}
+
 //Declare chip8 variables
 chip8 myChip8; //The one and only
 SDL_Rect chip8Rect = { 0, 0, 512, 256 }; //The chip8 display
 SDL_Rect regRect = { 0, 256, 512, 256 }; //The register display
 SDL_Rect memRect = { 512, 0, 512, 512 }; //The memory display
 SDL_Rect chip8Border = { -1, -1, 514, 258 }; //The border around chip8Rect
-std::map<int, int> keymap = { //The keymap
-		{ SDLK_1, 0x1 },
-		{ SDLK_2, 0x2 },
-		{ SDLK_3, 0x3 },
-		{ SDLK_4, 0xC },
-		{ SDLK_q, 0x4 },
-		{ SDLK_w, 0x5 },
-		{ SDLK_e, 0x6 },
-		{ SDLK_r, 0xD },
-		{ SDLK_a, 0x7 },
-		{ SDLK_s, 0x8 },
-		{ SDLK_d, 0x9 },
-		{ SDLK_f, 0xE },
-		{ SDLK_z, 0xA },
-		{ SDLK_x, 0x0 },
-		{ SDLK_c, 0xB },
-		{ SDLK_v, 0xF }
+const SDL_Scancode KEYPAD[16] = { //Physical key for each chip8 key, by position so the keypad keeps its shape on any layout
+		SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
+		SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+		SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+		SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V
+};
+signed char keyTable[SDL_NUM_SCANCODES]; //Chip8 key for every scancode, -1 if it isn't one, filled from KEYPAD by buildKeyTable
+
+//One emulated frame, handed from the emulation thread to the render thread
+struct frame_snapshot {
+	Uint32 pixels[DISPLAY_WIDTH * DISPLAY_HEIGHT]; //The display, expanded to colours
+	int width; //Display size in pixels at the resolution pixels was taken in
+	int height;
+	unsigned short registers[40]; //From getRegisters
+	unsigned long long draws; //Frames that drew so far, changes whenever pixels do
+	unsigned long long row_draws[DISPLAY_HEIGHT]; //Value of draws when each row last changed, so rows drawn in frames that were never shown are still uploaded
+	unsigned long long cycles; //Cycles run so far
+	Uint32 key_reads[16]; //Arrival time of the newest change to each key the ROM has read with EX9E, EXA1 or FX0A, 0 if none
 };
 
+//Declare thread variables, the emulation thread owns myChip8 once it has started
+triple_buffer<frame_snapshot> frames; //Completed frames, newest first
+std::atomic<bool> quit(false); //Quit flag
+std::atomic<int> mode(1); //Regular vs Cycle by cycle, see Modes comment in main
+std::atomic<int> max_cycles(500); //Maximum cycles per second
+std::atomic<unsigned short> keys(0); //Chip8 key state, bit n is key n
+std::atomic<Uint32> keyTimes[16]; //SDL ticks when each key last changed, stored before keys so a change is never seen without its time
+Uint32 pendingKeys[16]; //Arrival time of each key change applied to the machine but not read by the ROM yet, 0 if none. Emulation thread only.
+Uint32 readKeys[16]; //Arrival time of the newest change to each key the ROM has read. Emulation thread only.
+unsigned short appliedKeys = 0; //Key state last applied to the machine. Emulation thread only.
+std::vector<Uint32> latencies; //Milliseconds from each key change to the first frame presented after the ROM read it, render thread only
+const char* latencyPath = NULL; //File the latency report is written to, set with --latency
+input_record input; //Key changes being recorded or replayed, only touched by the emulation thread once it starts
+const char* recordPath = NULL; //File the input is recorded to, set with --record
+bool replaying = false; //Input comes from a recording loaded with --replay instead of the keyboard
+chip8_profile profile; //Instruction counts written on exit when profiling
+const char* profilePath = NULL; //File the profile report is written to, set with --profile
+
+//Fill keyTable from KEYPAD
+void buildKeyTable() {
+	memset(keyTable, -1, sizeof(keyTable));
+	for (int i = 0; i < 16; ++i) {
+		keyTable[KEYPAD[i]] = (signed char)i;
+	}
+}
+
+//Set or clear the chip8 key on a scancode and note when the change arrived. Repeats and unmapped keys are ignored.
+void pressKey(SDL_Scancode scancode, bool down, Uint32 timestamp) {
+	int code = (int)scancode;
+	int key = code >= 0 && code < SDL_NUM_SCANCODES ? keyTable[code] : -1;
+	if (key < 0 || (((keys.load() >> key) & 1) != 0) == down) {
+		return;
+	}
+	keyTimes[key].store(timestamp != 0 ? timestamp : SDL_GetTicks());
+	if (down) {
+		keys |= (unsigned short)(1 << key);
+	} else {
+		keys &= (unsigned short)~(1 << key);
+	}
+}
+
+//Set the chip8 keys for the frame starting at emulated cycle, from the keyboard or the replay, and record them.
+//Keyboard changes are timed from their arrival until the ROM reads them.
+void applyKeys(unsigned long long cycle) {
+	unsigned short pressed = replaying ? input.replay(cycle) : keys.load();
+	if (recordPath != NULL) {
+		input.record(cycle, pressed);
+	}
+	unsigned short changed = replaying ? 0 : pressed ^ appliedKeys;
+	for (int i = 0; i < 16; ++i) {
+		myChip8.key[i] = (pressed >> i) & 1;
+		if ((changed >> i) & 1) {
+			pendingKeys[i] = keyTimes[i].load();
+		}
+	}
+	appliedKeys = pressed;
+}
+
+//Move the key changes the ROM read since the last call from pending to read
+void takeKeyReads() {
+	for (int i = 0; i < 16; ++i) {
+		if (myChip8.key_read[i] && pendingKeys[i] != 0) {
+			readKeys[i] = pendingKeys[i];
+			pendingKeys[i] = 0;
+		}
+		myChip8.key_read[i] = 0;
+	}
+}
+
+//Write the distribution of key to frame latencies, false if the file can't be written
+bool writeLatencyReport(const char* path) {
+	#pragma warning(suppress : 4996)
+	FILE* file = fopen(path, "w");
+	if (file == NULL) {
+		return false;
+	}
+	std::vector<Uint32> sorted(latencies);
+	std::sort(sorted.begin(), sorted.end());
+	fprintf(file, "Speed: %i cycles/s\n", (int)max_cycles);
+	fprintf(file, "Key changes read and presented: %u\n", (unsigned)sorted.size());
+	if (!sorted.empty()) {
+		size_t last = sorted.size() - 1;
+		fprintf(file, "Latency ms: min %u, median %u, p90 %u, p99 %u, max %u\n", sorted[0], sorted[last / 2], sorted[last * 9 / 10], sorted[last * 99 / 100], sorted[last]);
+
+		//One line per millisecond that has any events
+		fprintf(file, "\nHistogram (ms, key changes):\n");
+		for (size_t i = 0; i < sorted.size(); ) {
+			size_t same = i;
+			while (same < sorted.size() && sorted[same] == sorted[i]) {
+				++same;
+			}
+			fprintf(file, "%6u %8u\n", sorted[i], (unsigned)(same - i));
+			i = same;
+		}
+	}
+	return fclose(file) == 0;
+}
+
+//Render the sound events of the frame that started at cycle start, queue it for the device and write it to the WAV file
+void playFrame(square_wave& wave, uint64_t start) {
+	int16_t samples[AUDIO_FRAME];
+	wave.render(samples, AUDIO_FRAME, myChip8.sound_events, myChip8.sound_event_count, start, myChip8.cycles_total - start);
+	myChip8.sound_event_count = 0;
+	if (audioDevice != 0 && audioSamples.size() < (size_t)AUDIO_MAX_QUEUED) {
+		audioSamples.write(samples, AUDIO_FRAME);
+	}
+	if (wavPath != NULL) {
+		wav.write(samples, AUDIO_FRAME);
+	}
+}
+
+//Emulation thread, runs the frames owed every 60hz tick and publishes each result
+void emulate() {
+	LFramePacer pacer; //Used for limiting how many frames per second
+	int cycle_debt = 0; //Cycles per second carried between frames, in 1/FRAME_RATE of a cycle
+	unsigned long long draws = 0; //Frames that drew so far
+	unsigned long long row_draws[DISPLAY_HEIGHT] = { 0 }; //Value of draws when each row last changed
+	unsigned long long cycles = 0; //Cycles run so far
+	unsigned long long emulated = 0; //Cycles every frame was given, including ones spent waiting on a key, input is recorded against these
+	square_wave wave(AUDIO_RATE, TONE_FREQUENCY, TONE_AMPLITUDE); //Buzzer, only rendered while running normally
+	while (!quit) {
+		//Limit speed of emulation, sleeping until the next frame is due (paused modes sleep here too)
+		int owed = pacer.wait();
+		int running = mode;
+		if (running != 0 && running != 2) {
+			continue;
+		}
+
+		if (running == 0) {
+			//Emulate a frame's worth of cycles for every frame owed
+			for (int frame = 0; frame < owed; ++frame) {
+				applyKeys(emulated);
+				cycle_debt += max_cycles;
+				unsigned long budget = cycle_debt / FRAME_RATE;
+				uint64_t start = myChip8.cycles_total;
+				chip8::run_result result = myChip8.runFrame(budget);
+				playFrame(wave, start);
+				emulated += budget;
+				cycle_debt %= FRAME_RATE;
+				cycles += myChip8.cycles_run;
+				if (result == chip8::RUN_INVALID_OPCODE) {
+					mode = 3;
+					break;
+				}
+			}
+		} else {
+			//Emulate a cycle
+			applyKeys(emulated);
+			++emulated;
+			if (!myChip8.emulateCycle()) {
+				mode = 3;
+			} else {
+				mode.compare_exchange_strong(running, 1); //Don't run cycle until space is pressed again
+			}
+			++cycles;
+			cycle_debt += FRAME_RATE;
+			if (cycle_debt >= max_cycles) {
+				cycle_debt -= max_cycles;
+				myChip8.updateTimers();
+			}
+		}
+
+		//Publish the frame, the render thread picks up whichever is newest when it next presents
+		takeKeyReads();
+		if (myChip8.dirty_rows != 0) {
+			++draws;
+			for (int y = 0; y < DISPLAY_HEIGHT; ++y) {
+				if ((myChip8.dirty_rows >> y) & 1) {
+					row_draws[y] = draws;
+				}
+			}
+			myChip8.dirty_rows = 0;
+		}
+		frame_snapshot& snapshot = frames.back();
+		myChip8.getPixelsRGBA(snapshot.pixels, pixelOn, pixelOff);
+		snapshot.width = myChip8.getWidth();
+		snapshot.height = myChip8.getHeight();
+		myChip8.getRegisters(snapshot.registers);
+		snapshot.draws = draws;
+		memcpy(snapshot.row_draws, row_draws, sizeof(row_draws));
+		snapshot.cycles = cycles;
+		memcpy(snapshot.key_reads, readKeys, sizeof(readKeys));
+		frames.publish();
+	}
+}
+
 
 //Main
 int main(int argc, char** argv) {
@@ -240,77 +729,165 @@ int main(int argc, char** argv) {
 
 	//Check if enough arguments are supplied
 	if (argc < 2) {
-		printf("Usage: OctoChip-8.exe <ROM path>\n");
+		printf("Usage: OctoChip-8.exe <ROM path> [--on RRGGBB] [--off RRGGBB] [--font TTF path] [--seed hex] [--quirks profile] [--record file | --replay file] [--profile report path] [--wav file] [--latency report path]\n");
 		return 1;
 	}
 
-	//Initialize display
+	//Read the palette, font, seed, quirks and recording
+	uint32_t seed = (uint32_t)time(NULL); //CXNN seed, printed so the run can be repeated
+	chip8::quirk_profile quirks = chip8::QUIRKS_OCTOCHIP; //Behaviour of opcodes interpreters disagree on
+	for (int i = 2; i < argc; ++i) {
+		if (strcmp(argv[i], "--font") == 0 && i + 1 < argc) {
+			fontPath = argv[++i];
+		} else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+			seed = (uint32_t)strtoul(argv[++i], NULL, 16);
+		} else if (strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+			if (!chip8::findQuirks(argv[++i], quirks)) {
+				printf("Unknown quirk profile %s, use octochip, vip, schip or xochip\n", argv[i]);
+				return 1;
+			}
+		} else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+			latencyPath = argv[++i];
+		} else if (strcmp(argv[i], "--wav") == 0 && i + 1 < argc) {
+			wavPath = argv[++i];
+		} else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+			profilePath = argv[++i];
+			myChip8.setProfile(&profile);
+		} else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+			recordPath = argv[++i];
+		} else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			input.clear(seed, max_cycles);
+			if (!input.load(argv[++i])) {
+				printf("Could not open recording %s\n", argv[i]);
+				return 1;
+			}
+			replaying = true;
+		} else if ((strcmp(argv[i], "--on") == 0 || strcmp(argv[i], "--off") == 0) && i + 1 < argc) {
+			Uint32& pixel = strcmp(argv[i], "--on") == 0 ? pixelOn : pixelOff;
+			unsigned int colour = 0;
+			#pragma warning(suppress : 4996)
+			if (sscanf(argv[++i], "%6x", &colour) != 1) {
+				printf("Bad colour: %s\n", argv[i]);
+				return 1;
+			}
+			pixel = 0xFF000000 | colour;
+		} else {
+			//Every option takes a value, so the last argument is either unknown or missing its value
+			printf("%s: %s\n", i + 1 < argc ? "Unknown option" : "Unknown option or missing value", argv[i]);
+			return 1;
+		}
+	}
+
+	//Initialize display and sound
 	if (!init_SDL()) {
 		printf("Failed to initialize SDL!\n");
 		return 1;
 	}
+	init_audio();
+	if (wavPath != NULL && !wav.open(wavPath, AUDIO_RATE)) {
+		printf("Could not write WAV file %s\n", wavPath);
+		return 1;
+	}
+
+	//A replay runs from its own seed, speed and quirks, a recording notes them
+	if (replaying) {
+		seed = input.seed;
+		max_cycles = std::max(1, input.speed);
+		if (!input.quirks.empty() && !chip8::findQuirks(input.quirks.c_str(), quirks)) {
+			printf("Unknown quirk profile %s in recording\n", input.quirks.c_str());
+			return 1;
+		}
+	} else if (recordPath != NULL) {
+		input.clear(seed, max_cycles);
+		input.quirks = chip8::quirksName(quirks);
+	}
+	printf("Seed: %08x\n", (unsigned int)seed);
 
 	//Load chip8 ROM
+	myChip8.seed(seed);
+	myChip8.setQuirks(quirks);
 	if (!myChip8.loadApplication(argv[1])) {
 		return 1;
 	}
 
+	//Build the glyph atlas and key table once, everything after uses them
+	buildKeyTable();
+	if (!textGrid.loadAtlas(fontPath)) {
+		return 1;
+	}
+
 	//Instructions screen
+	const char* instructions[15] = {
+		"Enter:   Run normally",
+		"Space:   Run one cycle",
+		"Control: Toggle registers",
+		"+/-: Change speed by 50",
+		"",
+		"Chip-8:        Keyboard:",
+		"+-+-+-+-+      +-+-+-+-+",
+		"|1|2|3|C|      |1|2|3|4|",
+		"+-+-+-+-+      +-+-+-+-+",
+		"|4|5|6|D|      |Q|W|E|R|",
+		"+-+-+-+-+  =>  +-+-+-+-+",
+		"|7|8|9|E|      |A|S|D|F|",
+		"+-+-+-+-+      +-+-+-+-+",
+		"|A|0|B|F|      |Z|X|C|V|",
+		"+-+-+-+-+      +-+-+-+-+"
+	};
 	SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
 	SDL_RenderClear(renderer);
-	textTexture.loadFromRenderedText("Enter:   Run normally", BLACK);
-	textTexture.render(18, 18);
-	textTexture.loadFromRenderedText("Space:   Run one cycle", BLACK);
-	textTexture.render(18, 38);
-	textTexture.loadFromRenderedText("Control: Toggle registers", BLACK);
-	textTexture.render(18, 58);
-	textTexture.loadFromRenderedText("+/-: Change speed by 50", BLACK);
-	textTexture.render(18, 78);
-	textTexture.loadFromRenderedText("Chip-8:        Keyboard:", BLACK);
-	textTexture.render(18, 118);
-	textTexture.loadFromRenderedText("+-+-+-+-+      +-+-+-+-+", BLACK);
-	textTexture.render(18, 138);
-	textTexture.loadFromRenderedText("|1|2|3|C|      |1|2|3|4|", BLACK);
-	textTexture.render(18, 158);
-	textTexture.loadFromRenderedText("+-+-+-+-+      +-+-+-+-+", BLACK);
-	textTexture.render(18, 178);
-	textTexture.loadFromRenderedText("|4|5|6|D|      |Q|W|E|R|", BLACK);
-	textTexture.render(18, 198);
-	textTexture.loadFromRenderedText("+-+-+-+-+  =>  +-+-+-+-+", BLACK);
-	textTexture.render(18, 218);
-	textTexture.loadFromRenderedText("|7|8|9|E|      |A|S|D|F|", BLACK);
-	textTexture.render(18, 238);
-	textTexture.loadFromRenderedText("+-+-+-+-+      +-+-+-+-+", BLACK);
-	textTexture.render(18, 258);
-	textTexture.loadFromRenderedText("|A|0|B|F|      |Z|X|C|V|", BLACK);
-	textTexture.render(18, 278);
-	textTexture.loadFromRenderedText("+-+-+-+-+      +-+-+-+-+", BLACK);
-	textTexture.render(18, 298);
+	textGrid.setLayout(18, 18, 25, 15, 20);
+	for (int i = 0; i < 15; ++i) {
+		textGrid.print(0, i, instructions[i]);
+	}
+	textGrid.render(BLACK);
 	SDL_RenderPresent(renderer);
 
 
-	//Stores the strings to display the register values, if displayed in hex instead of decimal then 50 is larger than needed
-	char regRow[9][50];
+	//Register panel, the labels are written once and each value only when it changes
+	char field[16];
 	//Names of the registers in the third column
 	char regCol3[8][3] = { "OP", "PC", "I", "SP", "", "", "DT", "ST" };
+	int shown[40]; //Register values on the panel, -1 if not written yet
+	textGrid.setLayout(4, 260, 39, 9, 18);
+	for (int i = 0; i < 8; ++i) {
+		snprintf(field, sizeof(field), "V%X:", i);
+		textGrid.print(0, i, field);
+		snprintf(field, sizeof(field), "V%X:", i + 8);
+		textGrid.print(7, i, field);
+		snprintf(field, sizeof(field), "S%X:", i);
+		textGrid.print(14, i, field);
+		snprintf(field, sizeof(field), "S%X:", i + 8);
+		textGrid.print(23, i, field);
+		if (regCol3[i][0] != '\0') {
+			snprintf(field, sizeof(field), "%2s:", regCol3[i]);
+			textGrid.print(32, i, field);
+		}
+	}
+	textGrid.print(0, 8, "Speed:        Cycles per second:");
+	for (int i = 0; i < 40; ++i) {
+		shown[i] = -1;
+	}
 
 
-	//Main loop
-	bool quit = false; //Quit flag
+	//Main loop, this thread handles input and presents while emulate runs the chip8
 	SDL_Event e; //SDL event
-	int mode = 1; //Regular vs Cycle by cycle, see Modes comment below
-	int regColor = 175; //Background color of the registers
 	Uint32 count_ticks = SDL_GetTicks(); //Used for counting how many cycles actually execute per second
-	int cycles = 0; //Used for counting how many cycles actually execute per second
+	unsigned long long counted_cycles = 0; //Cycles run when count_ticks was taken
 	bool display_registers = true; //Whether the registers should be displayed
-	int max_cycles = 500; //Maximum cycles per second
-	double cycle_length = 1000.0 / max_cycles; //Ticks per cycle
-	Uint32 limit_ticks = SDL_GetTicks(); //Used for limiting how many cycles per second
+	bool started = false; //A frame has been received, the instructions screen stays up until then
+	unsigned long long uploaded = 0; //Draws shown in displayTexture
+	Uint32 reported[16] = { 0 }; //Key change times whose latency has been counted
+	SDL_Rect displayRect = { 0, 0, 64, 32 }; //Part of displayTexture holding the display at its current resolution
+	LFramePacer pacer; //Paces the loop when presenting doesn't wait for vsync
+	SDL_RendererInfo info;
+	bool vsync = SDL_GetRendererInfo(renderer, &info) == 0 && (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
 	//Modes:
 	//0 - Run normally
 	//1 - Don't run cycle until space is pressed
-	//2 - Space has been pressed, run one cycle
+	//2 - Space has been pressed, run one cycle (the timers tick once a frame's worth of cycles have been stepped)
 	//3 - Unknown opcode, press enter to quit
+	std::thread emulation(emulate);
 	while (!quit) {
 		//Event loop
 		while (SDL_PollEvent(&e) != 0) {
@@ -330,8 +907,10 @@ int main(int argc, char** argv) {
 						mode = 0;
 					} break;
 
-				case SDLK_SPACE: //Space has been pressed, run one cycle
-					mode = 2; break;
+				case SDLK_SPACE: //Space has been pressed, run one cycle (not while recording or replaying, stepping can't be replayed)
+					if (mode != 3 && recordPath == NULL && !replaying) {
+						mode = 2;
+					} break;
 
 				case SDLK_LCTRL: //Toggle register display
 				case SDLK_RCTRL:
@@ -342,95 +921,121 @@ int main(int argc, char** argv) {
 						SDL_SetWindowSize(window, SCREEN_WIDTH, SCREEN_HEIGHT_SMALL);
 					} break;
 
-				case SDLK_EQUALS: //Increase speed by 50
-					max_cycles += 50;
-					cycle_length = 1000.0 / max_cycles;
-					break;
+				case SDLK_EQUALS: //Increase speed by 50, the speed is fixed while recording or replaying
+					if (recordPath == NULL && !replaying) {
+						max_cycles += 50;
+					} break;
 
 				case SDLK_MINUS: //Decrease speed by 50
-					if (max_cycles > 50) {
+					if (max_cycles > 50 && recordPath == NULL && !replaying) {
 						max_cycles -= 50;
-						cycle_length = 1000.0 / max_cycles;
 					} break;
 
 				default: //Chip8 key was pressed
-					if (keymap.count(e.key.keysym.sym) == 1) {
-						myChip8.key[keymap[e.key.keysym.sym]] = 1;
-					} break;
+					pressKey(e.key.keysym.scancode, true, e.key.timestamp);
+					break;
 				} break;
 
 			case SDL_KEYUP: //Chip8 key was released
-				if (keymap.count(e.key.keysym.sym) == 1) {
-					myChip8.key[keymap[e.key.keysym.sym]] = 0;
-				} break;
+				pressKey(e.key.keysym.scancode, false, e.key.timestamp);
+				break;
 			}
 		}
 
-		if (mode == 0 || mode == 2) {
-			//Emulate a cycle
-			if (!myChip8.emulateCycle()) {
-				mode = 3;
-				regColor = 150;
-			}
-
-			//Update chip8 display if it has changed
-			if (myChip8.draw_flag) {
-				SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-				SDL_RenderFillRect(renderer, &chip8Rect);
-				SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-				for (int y = 0; y < 32; ++y) {
-					for (int x = 0; x < 64; ++x) {
-						if (myChip8.gfx[x + (y * 64)] == 1) {
-							SDL_Rect pixelRect = { x * MODIFIER, y * MODIFIER, MODIFIER, MODIFIER };
-							SDL_RenderFillRect(renderer, &pixelRect);
-						}
+		//Pick up the newest emulated frame, and upload the runs of rows that changed since the last upload
+		if (frames.update()) {
+			started = true;
+			const frame_snapshot& frame = frames.front();
+			if (frame.draws != uploaded) {
+				displayRect.w = frame.width;
+				displayRect.h = frame.height;
+				for (int y = 0; y < frame.height; ++y) {
+					if (frame.row_draws[y] <= uploaded) {
+						continue;
+					}
+					SDL_Rect rows = { 0, y, frame.width, 1 };
+					while (y + 1 < frame.height && frame.row_draws[y + 1] > uploaded) {
+						++rows.h;
+						++y;
 					}
+					SDL_UpdateTexture(displayTexture, &rows, frame.pixels + rows.y * frame.width, frame.width * sizeof(Uint32));
 				}
+				uploaded = frame.draws;
 			}
+		}
 
+		bool presented = false;
+		if (started) {
 			if (display_registers) {
 				//Display registers
+				int regColor = mode == 3 ? 150 : 175; //Background color of the registers
 				SDL_SetRenderDrawColor(renderer, 175, regColor, regColor, 255);
 				SDL_RenderFillRect(renderer, &regRect);
-				unsigned short values[40] = { 0 };
-				myChip8.getRegisters(values);
-				for (int i = 0; i < 8; ++i) {
-					snprintf(regRow[i], 50, "V%X: %02X   V%X: %02X   S%X: %04X   S%X: %04X   %2s: %04X", i, values[i], i + 8, values[i + 8], i, values[i + 16], i + 8, values[i + 24], regCol3[i], values[i + 32]);
-					textTexture.loadFromRenderedText(regRow[i], BLACK);
-					textTexture.render(4, 260 + (18 * i));
+				const unsigned short* values = frames.front().registers;
+				for (int i = 0; i < 40; ++i) {
+					if (values[i] == shown[i] || (i >= 32 && regCol3[i - 32][0] == '\0')) {
+						continue;
+					}
+					shown[i] = values[i];
+					if (i < 16) { //V registers
+						snprintf(field, sizeof(field), "%02X", values[i]);
+						textGrid.print(i < 8 ? 3 : 10, i % 8, field);
+					} else if (i < 32) { //Stack
+						snprintf(field, sizeof(field), "%04X", values[i]);
+						textGrid.print(i < 24 ? 17 : 26, i % 8, field);
+					} else {
+						snprintf(field, sizeof(field), "%04X", values[i]);
+						textGrid.print(35, i - 32, field);
+					}
 				}
 
 				//Display cycles per second
-				++cycles;
 				if (SDL_GetTicks() - count_ticks > 1000) {
-					snprintf(regRow[8], 50, "Speed: %3i               Cycles per second: %4i", max_cycles, cycles);
-					cycles = 0;
+					snprintf(field, sizeof(field), "%-5i", (int)max_cycles);
+					textGrid.print(7, 8, field);
+					snprintf(field, sizeof(field), "%-6i", (int)(frames.front().cycles - counted_cycles));
+					textGrid.print(33, 8, field);
+					counted_cycles = frames.front().cycles;
 					count_ticks = SDL_GetTicks();
 				}
-				textTexture.loadFromRenderedText(regRow[8], BLACK);
-				textTexture.render(4, 404);
+				textGrid.render(BLACK);
 			}
 
-			//Update screen
-			if (display_registers || myChip8.draw_flag) {
-				SDL_RenderPresent(renderer);
+			//Update screen, at the display's refresh rate when vsync is on
+			SDL_RenderCopy(renderer, displayTexture, &displayRect, &chip8Rect); //The whole display in one scaled copy, either resolution fills chip8Rect
+			SDL_RenderPresent(renderer);
+			presented = true;
 
-				//Set draw flag to false
-				myChip8.draw_flag = false;
-			}
-
-			//Limit speed of emulation
-			while (SDL_GetTicks() - limit_ticks < cycle_length) continue;
-			limit_ticks = SDL_GetTicks();
-
-			//Don't run cycle until space is pressed
-			if (mode == 2) {
-				mode = 1;
+			//Key changes the shown frame is the first to have read
+			const Uint32* reads = frames.front().key_reads;
+			for (int i = 0; i < 16; ++i) {
+				if (reads[i] != reported[i]) {
+					reported[i] = reads[i];
+					if (latencyPath != NULL) {
+						latencies.push_back(SDL_GetTicks() - reads[i]);
+					}
+				}
 			}
 		}
+		if (!presented || !vsync) {
+			pacer.wait();
+		}
 	}
-	
+	emulation.join();
+	if (recordPath != NULL && !input.save(recordPath)) {
+		printf("Could not write recording %s\n", recordPath);
+	}
+	if (profilePath != NULL && !profile.writeReport(profilePath)) {
+		printf("Could not write profile %s\n", profilePath);
+	}
+	if (latencyPath != NULL && !writeLatencyReport(latencyPath)) {
+		printf("Could not write latency report %s\n", latencyPath);
+	}
+	if (wavPath != NULL && !wav.close()) {
+		printf("Could not write WAV file %s\n", wavPath);
+	}
+
 	printf("\n\nGoodbye.\n");
 	close_SDL();
 	return 0;
-}
\ No newline at end of file
+}
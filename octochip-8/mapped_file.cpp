@@ -0,0 +1,89 @@
+#include <stddef.h>
+#include "mapped_file.h"
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//Nothing mapped
+mapped_file::mapped_file() : bytes(NULL), length(0) {
+#if defined(_WIN32)
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#endif
+}
+
+//Unmap
+mapped_file::~mapped_file() {
+	close();
+}
+
+//Map a whole file, false if it can't be opened or mapped
+bool mapped_file::open(const char* path) {
+	close();
+#if defined(_WIN32)
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	LARGE_INTEGER file_size;
+	if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &file_size) || file_size.HighPart != 0) {
+		close();
+		return false;
+	}
+	length = file_size.LowPart;
+	if (length == 0) {
+		return true; //Empty files can't be mapped
+	}
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	bytes = mapping != NULL ? (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (bytes == NULL) {
+		close();
+		return false;
+	}
+#else
+	int fd = ::open(path, O_RDONLY);
+	struct stat info;
+	if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+		if (fd >= 0) {
+			::close(fd);
+		}
+		return false;
+	}
+	length = (unsigned long)info.st_size;
+	if (length > 0) {
+		void* view = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+		bytes = view != MAP_FAILED ? (const unsigned char*)view : NULL;
+	}
+	::close(fd); //The mapping keeps the file open
+	if (length > 0 && bytes == NULL) {
+		length = 0;
+		return false;
+	}
+#endif
+	return true;
+}
+
+//Unmap the file
+void mapped_file::close() {
+#if defined(_WIN32)
+	if (bytes != NULL) {
+		UnmapViewOfFile(bytes);
+	}
+	if (mapping != NULL) {
+		CloseHandle(mapping);
+	}
+	if (file != INVALID_HANDLE_VALUE) {
+		CloseHandle(file);
+	}
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#else
+	if (bytes != NULL) {
+		munmap((void*)bytes, length);
+	}
+#endif
+	bytes = NULL;
+	length = 0;
+}
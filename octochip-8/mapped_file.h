@@ -0,0 +1,24 @@
+#pragma once
+
+//A file mapped read-only into memory, so it can be read without copying it through stdio.
+class mapped_file {
+public:
+	mapped_file(); //Nothing mapped
+	~mapped_file(); //Unmap
+
+	bool open(const char* path); //Map a whole file, false if it can't be opened or mapped
+	void close(); //Unmap the file
+	const unsigned char* data() const { return bytes; } //First byte of the file, NULL if nothing or an empty file is mapped
+	unsigned long size() const { return length; } //Bytes in the file
+
+private:
+	const unsigned char* bytes; //Mapped view
+	unsigned long length; //Bytes mapped
+#if defined(_WIN32)
+	void* file; //File handle
+	void* mapping; //File mapping handle
+#endif
+
+	mapped_file(const mapped_file&);
+	mapped_file& operator=(const mapped_file&);
+};
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include "rom_pack.h"
+
+const unsigned char PACK_MAGIC[4] = { 'O', 'C', '8', 'P' }; //First bytes of every pack
+const unsigned short PACK_VERSION = 1; //Bumped whenever the layout changes
+const size_t PACK_HEADER = 12; //Bytes before the index
+const size_t PACK_ENTRY = 16; //Bytes per index entry
+
+//Read a little-endian 32-bit value
+static uint32_t get32(const unsigned char* in) {
+	return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+//Write a little-endian 32-bit value
+static void put32(unsigned char* out, uint32_t value) {
+	for (int i = 0; i < 4; ++i) {
+		out[i] = (unsigned char)(value >> (i * 8));
+	}
+}
+
+//Nothing open
+rom_pack::rom_pack() : roms(0) {
+}
+
+//Map a pack and check its index, false if it can't be opened or isn't a valid pack
+bool rom_pack::open(const char* path) {
+	close();
+	if (!file.open(path)) {
+		return false;
+	}
+	const unsigned char* bytes = file.data();
+	unsigned long length = file.size();
+	if (length < PACK_HEADER || memcmp(bytes, PACK_MAGIC, 4) != 0 || (bytes[4] | (bytes[5] << 8)) != PACK_VERSION) {
+		close();
+		return false;
+	}
+	roms = get32(bytes + 8);
+	if (roms > (length - PACK_HEADER) / PACK_ENTRY) {
+		close();
+		return false;
+	}
+
+	//Every name and ROM has to lie inside the file, and names have to be sorted for find
+	for (size_t i = 0; i < roms; ++i) {
+		if ((uint64_t)field(i, 0) + field(i, 1) > length || (uint64_t)field(i, 2) + field(i, 3) > length ||
+			(i > 0 && compare(i - 1, (const char*)bytes + field(i, 2), field(i, 3)) >= 0)) {
+			close();
+			return false;
+		}
+	}
+	return true;
+}
+
+//Unmap the pack
+void rom_pack::close() {
+	file.close();
+	roms = 0;
+}
+
+//Pack files under names, false if one can't be read or the pack can't be written
+bool rom_pack::write(const char* path, const std::vector<std::string>& names, const std::vector<std::string>& files) {
+	//Read every file and sort them by name
+	std::vector<std::pair<std::string, std::string> > entries;
+	for (size_t i = 0; i < files.size() && i < names.size(); ++i) {
+		mapped_file rom;
+		if (!rom.open(files[i].c_str())) {
+			return false;
+		}
+		entries.push_back(std::make_pair(names[i], std::string((const char*)rom.data(), rom.size())));
+	}
+	std::sort(entries.begin(), entries.end());
+	entries.erase(std::unique(entries.begin(), entries.end(), [](const std::pair<std::string, std::string>& a, const std::pair<std::string, std::string>& b) {
+		return a.first == b.first;
+	}), entries.end());
+
+	//Header and index, with names and then ROMs laid out after the index
+	std::vector<unsigned char> head(PACK_HEADER + entries.size() * PACK_ENTRY, 0);
+	memcpy(&head[0], PACK_MAGIC, 4);
+	head[4] = PACK_VERSION & 0xFF;
+	head[5] = PACK_VERSION >> 8;
+	put32(&head[8], (uint32_t)entries.size());
+	uint64_t offset = head.size();
+	for (size_t i = 0; i < entries.size(); ++i) {
+		put32(&head[PACK_HEADER + i * PACK_ENTRY + 8], (uint32_t)offset);
+		put32(&head[PACK_HEADER + i * PACK_ENTRY + 12], (uint32_t)entries[i].first.size());
+		offset += entries[i].first.size();
+	}
+	for (size_t i = 0; i < entries.size(); ++i) {
+		put32(&head[PACK_HEADER + i * PACK_ENTRY], (uint32_t)offset);
+		put32(&head[PACK_HEADER + i * PACK_ENTRY + 4], (uint32_t)entries[i].second.size());
+		offset += entries[i].second.size();
+	}
+	if (offset > 0xFFFFFFFFULL) {
+		return false; //Offsets are 32 bits
+	}
+
+	#pragma warning(suppress : 4996)
+	FILE* out = fopen(path, "wb");
+	if (out == NULL) {
+		return false;
+	}
+	fwrite(&head[0], 1, head.size(), out);
+	for (size_t i = 0; i < entries.size(); ++i) {
+		fwrite(entries[i].first.data(), 1, entries[i].first.size(), out);
+	}
+	for (size_t i = 0; i < entries.size(); ++i) {
+		fwrite(entries[i].second.data(), 1, entries[i].second.size(), out);
+	}
+	bool written = !ferror(out);
+	return fclose(out) == 0 && written;
+}
+
+//Name a ROM was packed under
+std::string rom_pack::name(size_t rom) const {
+	return std::string((const char*)file.data() + field(rom, 2), field(rom, 3));
+}
+
+//First byte of a ROM, in the mapping
+const uint8_t* rom_pack::data(size_t rom) const {
+	return file.data() + field(rom, 0);
+}
+
+//Bytes in a ROM
+size_t rom_pack::size(size_t rom) const {
+	return field(rom, 1);
+}
+
+//Index of the ROM packed under name, -1 if there isn't one
+long rom_pack::find(const char* name) const {
+	size_t length = strlen(name);
+	size_t low = 0;
+	size_t high = roms;
+	while (low < high) {
+		size_t middle = (low + high) / 2;
+		int order = compare(middle, name, length);
+		if (order == 0) {
+			return (long)middle;
+		}
+		if (order < 0) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return -1;
+}
+
+//One of a ROM's index fields
+uint32_t rom_pack::field(size_t rom, int index) const {
+	return get32(file.data() + PACK_HEADER + rom * PACK_ENTRY + index * 4);
+}
+
+//Order a ROM's name against name, like memcmp
+int rom_pack::compare(size_t rom, const char* name, size_t length) const {
+	size_t own = field(rom, 3);
+	int order = memcmp(file.data() + field(rom, 2), name, std::min(own, length));
+	if (order != 0) {
+		return order;
+	}
+	return own < length ? -1 : own > length ? 1 : 0;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+
+//Many ROMs in one file, mapped once so every load is a single copy from the mapping into a machine's memory.
+//Layout, all values little-endian:
+//  header  "OC8P", version (2 bytes), 0 (2 bytes), ROM count (4 bytes)
+//  index   one entry per ROM sorted by name: data offset, data size, name offset, name length (4 bytes each)
+//  names and ROM data, at the offsets the index gives
+class rom_pack {
+public:
+	rom_pack(); //Nothing open
+
+	bool open(const char* path); //Map a pack and check its index, false if it can't be opened or isn't a valid pack
+	void close(); //Unmap the pack
+	static bool write(const char* path, const std::vector<std::string>& names, const std::vector<std::string>& files); //Pack files under names, false if one can't be read or the pack can't be written
+
+	size_t count() const { return roms; } //ROMs in the pack
+	std::string name(size_t rom) const; //Name a ROM was packed under
+	const uint8_t* data(size_t rom) const; //First byte of a ROM, in the mapping
+	size_t size(size_t rom) const; //Bytes in a ROM
+	long find(const char* name) const; //Index of the ROM packed under name, -1 if there isn't one
+
+private:
+	mapped_file file; //The mapped pack
+	size_t roms; //ROMs in the pack
+
+	uint32_t field(size_t rom, int index) const; //One of a ROM's index fields
+	int compare(size_t rom, const char* name, size_t length) const; //Order a ROM's name against name, like memcmp
+
+	rom_pack(const rom_pack&);
+	rom_pack& operator=(const rom_pack&);
+};
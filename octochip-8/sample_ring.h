@@ -0,0 +1,56 @@
+#pragma once
+#include <stddef.h>
+#include <atomic>
+
+//Passes samples from one writer thread to one reader thread without locks. The writer appends with write() and the
+//reader takes them in order with read(). Neither side ever waits, samples that don't fit are left to the writer.
+//Size must be a power of two.
+template <typename T, size_t Size>
+class sample_ring {
+public:
+	sample_ring() : head(0), tail(0) {}
+
+	//Append up to count values, returns how many fit
+	size_t write(const T values[], size_t count) {
+		size_t h = head.load(std::memory_order_relaxed);
+		size_t free = Size - (h - tail.load(std::memory_order_acquire));
+		if (count > free) {
+			count = free;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			slots[(h + i) & MASK] = values[i];
+		}
+		head.store(h + count, std::memory_order_release);
+		return count;
+	}
+
+	//Take up to count values, returns how many there were
+	size_t read(T values[], size_t count) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		size_t queued = head.load(std::memory_order_acquire) - t;
+		if (count > queued) {
+			count = queued;
+		}
+		for (size_t i = 0; i < count; ++i) {
+			values[i] = slots[(t + i) & MASK];
+		}
+		tail.store(t + count, std::memory_order_release);
+		return count;
+	}
+
+	//Values waiting to be read. The writer may see more than there are and the reader fewer, never the other way round
+	size_t size() const {
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+
+private:
+	static const size_t MASK = Size - 1;
+	static_assert((Size & MASK) == 0, "sample_ring size must be a power of two");
+
+	T slots[Size];
+	alignas(64) std::atomic<size_t> head; //Values ever written, only advanced by the writer
+	alignas(64) std::atomic<size_t> tail; //Values ever read, only advanced by the reader
+
+	sample_ring(const sample_ring&);
+	sample_ring& operator=(const sample_ring&);
+};
@@ -0,0 +1,58 @@
+#include <algorithm>
+#include "state_table.h"
+
+//Empty table with room for capacity hashes before growing
+state_table::state_table(size_t capacity) : count(0) {
+	size_t size = 16;
+	while (size < capacity * 2) {
+		size *= 2;
+	}
+	slots.assign(size, 0);
+}
+
+//Add a hash, false if it was already there
+bool state_table::insert(uint64_t hash) {
+	hash = hash != 0 ? hash : 1;
+	size_t slot = find(hash);
+	if (slots[slot] == hash) {
+		return false;
+	}
+	slots[slot] = hash;
+	if (++count * 2 > slots.size()) {
+		grow();
+	}
+	return true;
+}
+
+//True if the hash has been added
+bool state_table::contains(uint64_t hash) const {
+	hash = hash != 0 ? hash : 1;
+	return slots[find(hash)] == hash;
+}
+
+//Forget every hash, keeping the memory
+void state_table::clear() {
+	std::fill(slots.begin(), slots.end(), 0);
+	count = 0;
+}
+
+//Slot holding hash, or the empty slot it would go in. State hashes are already well mixed, so the low bits pick the slot.
+size_t state_table::find(uint64_t hash) const {
+	size_t mask = slots.size() - 1;
+	size_t slot = (size_t)hash & mask;
+	while (slots[slot] != 0 && slots[slot] != hash) {
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+//Double the slots and reinsert every hash
+void state_table::grow() {
+	std::vector<uint64_t> old(slots.size() * 2, 0);
+	old.swap(slots);
+	for (size_t i = 0; i < old.size(); ++i) {
+		if (old[i] != 0) {
+			slots[find(old[i])] = old[i];
+		}
+	}
+}
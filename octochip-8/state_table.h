@@ -0,0 +1,23 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+//Set of chip8::getStateHash values, for dropping machines a search has already reached by another path.
+//Open addressing with linear probing, doubled whenever it gets half full. Hash 0 is stored as 1 since 0 marks an empty slot.
+class state_table {
+public:
+	state_table(size_t capacity = 1024); //Empty table with room for capacity hashes before growing
+
+	bool insert(uint64_t hash); //Add a hash, false if it was already there
+	bool contains(uint64_t hash) const; //True if the hash has been added
+	void clear(); //Forget every hash, keeping the memory
+	size_t size() const { return count; } //Hashes added
+
+private:
+	std::vector<uint64_t> slots; //Power of two slots, 0 if empty
+	size_t count; //Slots in use
+
+	size_t find(uint64_t hash) const; //Slot holding hash, or the empty slot it would go in
+	void grow(); //Double the slots and reinsert every hash
+};
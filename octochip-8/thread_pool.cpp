@@ -0,0 +1,74 @@
+#include <stdlib.h>
+#include <algorithm>
+#include <thread>
+#include "thread_pool.h"
+
+//0 uses one worker per core. Every worker needs its own machine or buffers, so a count far beyond the cores is capped
+//instead of allocating for workers that could never run at once.
+thread_pool::thread_pool(unsigned threads) {
+	unsigned cores = std::thread::hardware_concurrency();
+	if (cores == 0) {
+		cores = 1;
+	}
+	workers = threads == 0 ? cores : std::min(threads, cores * MAX_PER_CORE);
+}
+
+//Read a --threads value, false if it isn't a count of 0 or more
+bool thread_pool::parseThreads(const char* text, unsigned& threads) {
+	char* end;
+	long count = strtol(text, &end, 10);
+	if (end == text || *end != '\0' || count < 0) {
+		return false;
+	}
+	threads = (unsigned)std::min(count, 65535L); //Far past any cap, so a huge count can't wrap to a small one
+	return true;
+}
+
+//Number of workers
+unsigned thread_pool::size() {
+	return workers;
+}
+
+//Run jobs 0 to jobs-1 and wait for all of them
+void thread_pool::run(size_t jobs, std::function<void(size_t job, unsigned worker)> work) {
+	//Deal the jobs out round robin so every queue starts with a similar mix
+	std::vector<queue> queues(workers);
+	for (size_t i = 0; i < jobs; ++i) {
+		queues[i % workers].jobs.push_back(i);
+	}
+
+	std::vector<std::thread> threads;
+	for (unsigned w = 0; w < workers; ++w) {
+		threads.push_back(std::thread([this, &queues, &work, w]() {
+			size_t job;
+			while (take(queues, w, job)) {
+				work(job, w);
+			}
+		}));
+	}
+	for (size_t i = 0; i < threads.size(); ++i) {
+		threads[i].join();
+	}
+}
+
+//Pop own work or steal, false once every queue is empty
+bool thread_pool::take(std::vector<queue>& queues, unsigned worker, size_t& job) {
+	{
+		std::lock_guard<std::mutex> guard(queues[worker].lock);
+		if (!queues[worker].jobs.empty()) {
+			job = queues[worker].jobs.back();
+			queues[worker].jobs.pop_back();
+			return true;
+		}
+	}
+	for (unsigned i = 1; i < workers; ++i) {
+		queue& victim = queues[(worker + i) % workers];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.jobs.empty()) {
+			job = victim.jobs.front();
+			victim.jobs.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stddef.h>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+//Runs a fixed list of jobs on every core. Each worker takes jobs from the back of its own queue
+//and steals from the front of the others once it runs dry, so long jobs don't leave cores idle.
+class thread_pool {
+public:
+	static const unsigned MAX_PER_CORE = 4; //Workers asked for beyond this many per core are not started
+
+	thread_pool(unsigned threads = 0); //0 uses one worker per core, more than MAX_PER_CORE per core are capped
+	static bool parseThreads(const char* text, unsigned& threads); //Read a --threads value, false if it isn't a count of 0 or more
+
+	unsigned size(); //Number of workers
+	void run(size_t jobs, std::function<void(size_t job, unsigned worker)> work); //Run jobs 0 to jobs-1 and wait for all of them
+
+private:
+	//One worker's queue of job indices
+	struct queue {
+		std::mutex lock;
+		std::deque<size_t> jobs;
+	};
+
+	unsigned workers; //Number of workers
+
+	bool take(std::vector<queue>& queues, unsigned worker, size_t& job); //Pop own work or steal, false once every queue is empty
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+
+//Hands the newest value from one writer thread to one reader thread without locks. The writer fills back()
+//and publishes it, the reader picks up the newest published value with update() and reads front().
+//Neither side ever waits, values published faster than they are read are dropped.
+template <typename T>
+class triple_buffer {
+public:
+	triple_buffer() : middle(1), back_index(0), front_index(2) {}
+
+	T& back() { return slots[back_index]; } //Slot the writer fills next
+	const T& front() const { return slots[front_index]; } //Newest value the reader picked up
+
+	//Hand back() to the reader and take the slot it isn't using
+	void publish() {
+		back_index = middle.exchange(back_index | FRESH, std::memory_order_acq_rel) & INDEX;
+	}
+
+	//Pick up the newest published value, false if nothing was published since the last update
+	bool update() {
+		if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+			return false;
+		}
+		front_index = middle.exchange(front_index, std::memory_order_acq_rel) & INDEX;
+		return true;
+	}
+
+private:
+	static const unsigned INDEX = 3; //Slot index bits of middle
+	static const unsigned FRESH = 4; //Set in middle when it holds a value the reader hasn't taken
+
+	T slots[3];
+	std::atomic<unsigned> middle; //Slot between the two threads, plus FRESH
+	unsigned back_index; //Only touched by the writer
+	unsigned front_index; //Only touched by the reader
+
+	triple_buffer(const triple_buffer&);
+	triple_buffer& operator=(const triple_buffer&);
+};